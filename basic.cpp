@@ -1,10 +1,27 @@
 #include <assert.h>
 #include <memory.h>
+#include <string.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
 
+#if defined(__AVX512BW__)
+#define SIMD_AVX512 1
+#elif defined(__AVX2__)
+#define SIMD_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2 1
+#endif
+
+#if defined(SIMD_AVX512) || defined(SIMD_AVX2) || defined(SIMD_SSE2)
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 // Useful macros
 #define ArrayLen(x) (sizeof(x) / sizeof(*x))
 
@@ -21,11 +38,12 @@
 #define IsEnabled(x) ((x) != 0)
 
 #define MemoryCopy(ptr, ptr2, len) memcpy(ptr, ptr2, len)
-#define MemorySet(ptr, value, len) memset(ptr, value, len)
+#define MemoryMove(ptr, ptr2, len) memmove(ptr, ptr2, len)
+#define MemorySet(ptr, value, len) memset((void*)(ptr), value, len)
 #define MemoryZero(ptr, len) MemorySet(ptr, 0, len)
 
 #define Assert(x) assert(x)
-#define AssertMessage(x, message, ...) do { if (!(x)) { fprintf(stderr, message, __VA_ARGS__); assert(x); } } while (0)
+#define AssertMessage(x, message, ...) do { if (!(x)) { fprintf(stderr, message, ##__VA_ARGS__); assert(x); } } while (0)
 
 // Use this to declare a dynamic array type.
 #define DArray_Type(Name, Type) typedef struct DArray_##Name { Type *data; S64 size; S64 cap; } DArray_##Name
@@ -46,15 +64,17 @@
 #define U32_MAX (U32)0xffffffff
 #define U64_MAX (U64)0xffffffffffffffffULL
 
+#define F32_MAX 3.402823466e+38f
+
 // Types
 typedef int8_t   S8;
 typedef int16_t  S16;
 typedef int32_t  S32;
-typedef int64_t  S64;
+typedef long long S64; // long long rather than int64_t so %lld/%llu are correct on every platform.
 typedef uint8_t  U8;
 typedef uint16_t U16;
 typedef uint32_t U32;
-typedef uint64_t U64;
+typedef unsigned long long U64;
 
 typedef float  F32;
 typedef double F64;
@@ -65,12 +85,19 @@ struct String8 {
 	size_t len;
 };
 
+enum Arena_Flags {
+	ARENA_FLAG_NONE        = 0,
+	ARENA_FLAG_LARGE_PAGES = (1 << 0), // Back the arena with huge pages where the OS allows it.
+};
+
 typedef struct Arena Arena;
 struct Arena {
 	U8 *base;
 	size_t size;
 	size_t used;
 	size_t minimum_block_size;
+	U32 flags;
+	size_t reserve_size; // Address space reserved on first use. 0 means ARENA_RESERVE_SIZE.
 
 	// size_t temp_allocation_size;
 };
@@ -78,21 +105,42 @@ struct Arena {
 typedef struct File File;
 struct File {
 	bool success;
+	bool mapped; // data points into a read-only file mapping and must be released with unmap_file().
 	U8 *data = (U8*)"";
 	size_t len;
 };
 
 // Global variables
-Arena _scratch = {0, 0, 0, Megabytes(1)};
+Arena _scratch = {0, 0, 0, Megabytes(1), ARENA_FLAG_NONE, 0};
+
+// Memory committed by all arenas together, for measuring what a piece of work needs at most.
+volatile S64 _arena_committed;
+volatile S64 _arena_peak_committed;
 
 // Forward declarations
 U32 get_page_size(void);
+size_t get_large_page_size(void);
 
 void *allocate_memory(size_t size);
-void *reserve_memory(size_t size);
-void *commit_memory(void *memory, size_t size);
-
+void *reserve_memory(size_t size, bool large_pages = false);
+void *commit_memory(void *memory, size_t size, bool large_pages = false);
+void release_memory(void *memory, size_t size);
+
+typedef void Thread_Proc(void *parameter);
+S32 get_processor_count(void);
+bool create_thread(Thread_Proc *proc, void *parameter);
+void *make_semaphore(U32 initial_count);
+void semaphore_signal(void *semaphore, U32 count);
+void semaphore_wait(void *semaphore);
+
+double get_time_in_seconds(void);
 void exit_process(int return_code);
+File map_file(char *path_to_file);
+void unmap_file(File *file);
+bool write_file(char *path_to_file, void *data, size_t len);
+U64 get_file_modified_time(char *path_to_file);
+U64 get_file_size(char *path_to_file);
+char **list_files(Arena *arena, char *directory, char *extension, S64 *count);
 void notification_window(char *title, char *text);
 
 // Useful functions
@@ -109,7 +157,7 @@ bool is_whitespace(char c) {
 }
 
 bool is_letter(char c) {
-	return c >= 'a' && c <= 'z' || c >= 'A' && c <= 'Z';
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
 }
 
 bool is_digit(char c) {
@@ -120,6 +168,148 @@ bool is_alphanumeric(char c) {
 	return is_letter(c) || is_digit(c);
 }
 
+// Bit manipulation
+U32 count_trailing_zeros(U64 x) {
+	Assert(x != 0);
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward64(&index, x);
+	return (U32)index;
+#else
+	return (U32)__builtin_ctzll(x);
+#endif
+}
+
+U32 count_set_bits(U64 x) {
+#if defined(_MSC_VER)
+	return (U32)__popcnt64(x);
+#else
+	return (U32)__builtin_popcountll(x);
+#endif
+}
+
+// Atomics. Both are full barriers and return the value from before the operation.
+S64 atomic_add_s64(volatile S64 *value, S64 addend) {
+#if defined(_MSC_VER)
+	return _InterlockedExchangeAdd64((volatile long long*)value, addend);
+#else
+	return __atomic_fetch_add(value, addend, __ATOMIC_SEQ_CST);
+#endif
+}
+
+S64 atomic_exchange_s64(volatile S64 *value, S64 new_value) {
+#if defined(_MSC_VER)
+	return _InterlockedExchange64((volatile long long*)value, new_value);
+#else
+	return __atomic_exchange_n(value, new_value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// Stores new_value only if the value is still expected.
+S64 atomic_compare_exchange_s64(volatile S64 *value, S64 expected, S64 new_value) {
+#if defined(_MSC_VER)
+	return _InterlockedCompareExchange64((volatile long long*)value, new_value, expected);
+#else
+	__atomic_compare_exchange_n(value, &expected, new_value, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return expected;
+#endif
+}
+
+// Acquire loads and release stores: what was written before a release store is visible after an acquire load that
+// reads its value.
+S64 atomic_load_acquire_s64(volatile S64 *value) {
+#if defined(_MSC_VER)
+	S64 result = *value;
+	_ReadWriteBarrier();
+	return result;
+#else
+	return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#endif
+}
+
+void atomic_store_release_s64(volatile S64 *value, S64 new_value) {
+#if defined(_MSC_VER)
+	_ReadWriteBarrier();
+	*value = new_value;
+#else
+	__atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+#endif
+}
+
+void *atomic_load_acquire_pointer(void *volatile *value) {
+#if defined(_MSC_VER)
+	void *result = *value;
+	_ReadWriteBarrier();
+	return result;
+#else
+	return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#endif
+}
+
+void atomic_store_release_pointer(void *volatile *value, void *new_value) {
+#if defined(_MSC_VER)
+	_ReadWriteBarrier();
+	*value = new_value;
+#else
+	__atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+#endif
+}
+
+// Character classification of whole blocks of text. Bit i of each mask describes block[i]. The block size is the
+// widest vector the build targets; without SIMD the masks are built byte by byte.
+#if defined(SIMD_AVX512)
+#define CHAR_BLOCK_SIZE 64
+#elif defined(SIMD_AVX2)
+#define CHAR_BLOCK_SIZE 32
+#else
+#define CHAR_BLOCK_SIZE 16
+#endif
+
+#define CHAR_BLOCK_FULL_MASK (CHAR_BLOCK_SIZE == 64 ? U64_MAX : ((1ULL << CHAR_BLOCK_SIZE) - 1))
+
+typedef struct Char_Masks Char_Masks;
+struct Char_Masks {
+	U64 whitespace;      // ' ', '\t', '\n', '\v', '\f', '\r'
+	U64 line_feed;       // '\n'
+	U64 carriage_return; // '\r'
+};
+
+Char_Masks classify_char_block(char *block) {
+	Char_Masks masks;
+#if defined(SIMD_AVX512)
+	__m512i c = _mm512_loadu_si512((void*)block);
+	// '\t' through '\r' are the contiguous range 9..13.
+	__m512i c_minus_tab = _mm512_sub_epi8(c, _mm512_set1_epi8('\t'));
+	masks.line_feed = _mm512_cmpeq_epi8_mask(c, _mm512_set1_epi8('\n'));
+	masks.carriage_return = _mm512_cmpeq_epi8_mask(c, _mm512_set1_epi8('\r'));
+	masks.whitespace = _mm512_cmpeq_epi8_mask(c, _mm512_set1_epi8(' ')) | _mm512_cmple_epu8_mask(c_minus_tab, _mm512_set1_epi8(4));
+#elif defined(SIMD_AVX2)
+	__m256i c = _mm256_loadu_si256((__m256i*)block);
+	__m256i c_minus_tab = _mm256_sub_epi8(c, _mm256_set1_epi8('\t'));
+	__m256i in_tab_range = _mm256_cmpeq_epi8(_mm256_min_epu8(c_minus_tab, _mm256_set1_epi8(4)), c_minus_tab);
+	__m256i space = _mm256_cmpeq_epi8(c, _mm256_set1_epi8(' '));
+	masks.line_feed = (U32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('\n')));
+	masks.carriage_return = (U32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('\r')));
+	masks.whitespace = (U32)_mm256_movemask_epi8(_mm256_or_si256(space, in_tab_range));
+#elif defined(SIMD_SSE2)
+	__m128i c = _mm_loadu_si128((__m128i*)block);
+	__m128i c_minus_tab = _mm_sub_epi8(c, _mm_set1_epi8('\t'));
+	__m128i in_tab_range = _mm_cmpeq_epi8(_mm_min_epu8(c_minus_tab, _mm_set1_epi8(4)), c_minus_tab);
+	__m128i space = _mm_cmpeq_epi8(c, _mm_set1_epi8(' '));
+	masks.line_feed = (U32)_mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8('\n')));
+	masks.carriage_return = (U32)_mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8('\r')));
+	masks.whitespace = (U32)_mm_movemask_epi8(_mm_or_si128(space, in_tab_range));
+#else
+	masks = {};
+	for (int i = 0; i < CHAR_BLOCK_SIZE; i += 1) {
+		masks.whitespace |= (U64)is_whitespace(block[i]) << i;
+		masks.line_feed |= (U64)(block[i] == '\n') << i;
+		masks.carriage_return |= (U64)(block[i] == '\r') << i;
+	}
+#endif
+	return masks;
+}
+
 bool is_power_of_two(uintptr_t x) {
 	return (x & (x-1)) == 0;
 }
@@ -128,8 +318,13 @@ S64 next_multiple_of(S64 multiple, S64 value) {
 	return (value / multiple + 1) * multiple;
 }
 
+// Like next_multiple_of, the result is always greater than value.
 S64 next_power_of(S64 power, S64 value) {
-	return 0;
+	S64 result = 1;
+	while (result <= value) {
+		result *= power;
+	}
+	return result;
 }
 
 int string_compare(char *a, char *b) {
@@ -257,6 +452,50 @@ int string_to_int(char *str, int len) {
 	return i;
 }
 
+// SWAR digit parsing. Eight characters are handled per step as the bytes of one U64.
+// Returns the number of leading bytes of x (in memory order) that are ASCII digits.
+U32 count_leading_digits_u64(U64 x) {
+	// A byte is a digit if its high nibble is 3 and its low nibble is below 10. Neither test carries into the next byte.
+	U64 high_nibble_mismatch = (x & 0xF0F0F0F0F0F0F0F0ULL) ^ 0x3030303030303030ULL;
+	U64 low_nibble_too_big = ((x & 0x0F0F0F0F0F0F0F0FULL) + 0x0606060606060606ULL) & 0x1010101010101010ULL;
+	U64 not_digit = high_nibble_mismatch | low_nibble_too_big;
+	U64 not_digit_high_bits = (((not_digit & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL) | not_digit) & 0x8080808080808080ULL;
+	return not_digit_high_bits ? count_trailing_zeros(not_digit_high_bits) / 8 : 8;
+}
+
+// Converts the first digit_count (1 to 8) digit bytes of x to their value.
+U32 eight_digits_to_u32(U64 x, U32 digit_count) {
+	// Move the digits to the top so the empty bytes below them act as leading zeros.
+	x = (x - 0x3030303030303030ULL) << (8 * (8 - digit_count));
+	x = (x * 10) + (x >> 8);
+	x = (((x & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+	     (((x >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+	return (U32)x;
+}
+
+// Parses the run of digits starting at `at`. Reads whole 8-byte words, but never at or beyond `limit`.
+// Returns the number of digits. The value is only meaningful for up to 19 digits.
+S64 parse_digits(char *at, char *limit, U64 *value) {
+	static U64 powers_of_ten[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+	U64 result = 0;
+	S64 digit_count = 0;
+	for (;;) {
+		U64 x = 0;
+		MemoryCopy(&x, at, (size_t)Min(limit - at, 8)); // Bytes past the limit stay zero, which isn't a digit.
+		U32 n = count_leading_digits_u64(x);
+		if (n > 0) {
+			result = result * powers_of_ten[n] + eight_digits_to_u32(x, n);
+		}
+		digit_count += n;
+		at += n;
+		if (n < 8) {
+			break;
+		}
+	}
+	*value = result;
+	return digit_count;
+}
+
 float string_to_float(char *str, int len) {
 	// 1 sign character + largest integral part: 39 + 1 decimal point + fractional part: 7 = 48
 	char null_terminated_str[49] = {0};
@@ -265,6 +504,253 @@ float string_to_float(char *str, int len) {
 	return f;
 }
 
+// 64 x 64 -> 128 bit multiplication. Returns the low half and stores the high half.
+U64 multiply_u64_full(U64 a, U64 b, U64 *high) {
+#if defined(_MSC_VER) && defined(_M_X64)
+	return _umul128(a, b, high);
+#else
+	unsigned __int128 product = (unsigned __int128)a * b;
+	*high = (U64)(product >> 64);
+	return (U64)product;
+#endif
+}
+
+U32 count_leading_zeros(U64 x) {
+	Assert(x != 0);
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanReverse64(&index, x);
+	return 63 - (U32)index;
+#else
+	return (U32)__builtin_clzll(x);
+#endif
+}
+
+//
+// Decimal to binary32 conversion.
+//
+// decimal_to_f32() turns mantissa * 10^exponent10 into the nearest float, rounding ties to even, without going
+// through a double and without looking at the locale. Small values that fit into a float exactly take Clinger's fast
+// path; everything else goes through the Eisel-Lemire algorithm. The few inputs Eisel-Lemire can't decide are handed
+// to the C library, parsed in the "C" locale.
+#define F32_SMALLEST_POWER_OF_TEN -65
+#define F32_LARGEST_POWER_OF_TEN   38
+
+// 128-bit approximations of 5^q for q in [-65, 38], normalized so that the top bit is set. Generated with the same
+// script as the tables of the fast_float library, restricted to the range binary32 needs.
+U64 power_of_five_128[] = {
+	0x86ccbb52ea94baeaULL, 0x98e947129fc2b4e9ULL, // 5^-65
+	0xa87fea27a539e9a5ULL, 0x3f2398d747b36224ULL, // 5^-64
+	0xd29fe4b18e88640eULL, 0x8eec7f0d19a03aadULL, // 5^-63
+	0x83a3eeeef9153e89ULL, 0x1953cf68300424acULL, // 5^-62
+	0xa48ceaaab75a8e2bULL, 0x5fa8c3423c052dd7ULL, // 5^-61
+	0xcdb02555653131b6ULL, 0x3792f412cb06794dULL, // 5^-60
+	0x808e17555f3ebf11ULL, 0xe2bbd88bbee40bd0ULL, // 5^-59
+	0xa0b19d2ab70e6ed6ULL, 0x5b6aceaeae9d0ec4ULL, // 5^-58
+	0xc8de047564d20a8bULL, 0xf245825a5a445275ULL, // 5^-57
+	0xfb158592be068d2eULL, 0xeed6e2f0f0d56712ULL, // 5^-56
+	0x9ced737bb6c4183dULL, 0x55464dd69685606bULL, // 5^-55
+	0xc428d05aa4751e4cULL, 0xaa97e14c3c26b886ULL, // 5^-54
+	0xf53304714d9265dfULL, 0xd53dd99f4b3066a8ULL, // 5^-53
+	0x993fe2c6d07b7fabULL, 0xe546a8038efe4029ULL, // 5^-52
+	0xbf8fdb78849a5f96ULL, 0xde98520472bdd033ULL, // 5^-51
+	0xef73d256a5c0f77cULL, 0x963e66858f6d4440ULL, // 5^-50
+	0x95a8637627989aadULL, 0xdde7001379a44aa8ULL, // 5^-49
+	0xbb127c53b17ec159ULL, 0x5560c018580d5d52ULL, // 5^-48
+	0xe9d71b689dde71afULL, 0xaab8f01e6e10b4a6ULL, // 5^-47
+	0x9226712162ab070dULL, 0xcab3961304ca70e8ULL, // 5^-46
+	0xb6b00d69bb55c8d1ULL, 0x3d607b97c5fd0d22ULL, // 5^-45
+	0xe45c10c42a2b3b05ULL, 0x8cb89a7db77c506aULL, // 5^-44
+	0x8eb98a7a9a5b04e3ULL, 0x77f3608e92adb242ULL, // 5^-43
+	0xb267ed1940f1c61cULL, 0x55f038b237591ed3ULL, // 5^-42
+	0xdf01e85f912e37a3ULL, 0x6b6c46dec52f6688ULL, // 5^-41
+	0x8b61313bbabce2c6ULL, 0x2323ac4b3b3da015ULL, // 5^-40
+	0xae397d8aa96c1b77ULL, 0xabec975e0a0d081aULL, // 5^-39
+	0xd9c7dced53c72255ULL, 0x96e7bd358c904a21ULL, // 5^-38
+	0x881cea14545c7575ULL, 0x7e50d64177da2e54ULL, // 5^-37
+	0xaa242499697392d2ULL, 0xdde50bd1d5d0b9e9ULL, // 5^-36
+	0xd4ad2dbfc3d07787ULL, 0x955e4ec64b44e864ULL, // 5^-35
+	0x84ec3c97da624ab4ULL, 0xbd5af13bef0b113eULL, // 5^-34
+	0xa6274bbdd0fadd61ULL, 0xecb1ad8aeacdd58eULL, // 5^-33
+	0xcfb11ead453994baULL, 0x67de18eda5814af2ULL, // 5^-32
+	0x81ceb32c4b43fcf4ULL, 0x80eacf948770ced7ULL, // 5^-31
+	0xa2425ff75e14fc31ULL, 0xa1258379a94d028dULL, // 5^-30
+	0xcad2f7f5359a3b3eULL, 0x096ee45813a04330ULL, // 5^-29
+	0xfd87b5f28300ca0dULL, 0x8bca9d6e188853fcULL, // 5^-28
+	0x9e74d1b791e07e48ULL, 0x775ea264cf55347eULL, // 5^-27
+	0xc612062576589ddaULL, 0x95364afe032a819eULL, // 5^-26
+	0xf79687aed3eec551ULL, 0x3a83ddbd83f52205ULL, // 5^-25
+	0x9abe14cd44753b52ULL, 0xc4926a9672793543ULL, // 5^-24
+	0xc16d9a0095928a27ULL, 0x75b7053c0f178294ULL, // 5^-23
+	0xf1c90080baf72cb1ULL, 0x5324c68b12dd6339ULL, // 5^-22
+	0x971da05074da7beeULL, 0xd3f6fc16ebca5e04ULL, // 5^-21
+	0xbce5086492111aeaULL, 0x88f4bb1ca6bcf585ULL, // 5^-20
+	0xec1e4a7db69561a5ULL, 0x2b31e9e3d06c32e6ULL, // 5^-19
+	0x9392ee8e921d5d07ULL, 0x3aff322e62439fd0ULL, // 5^-18
+	0xb877aa3236a4b449ULL, 0x09befeb9fad487c3ULL, // 5^-17
+	0xe69594bec44de15bULL, 0x4c2ebe687989a9b4ULL, // 5^-16
+	0x901d7cf73ab0acd9ULL, 0x0f9d37014bf60a11ULL, // 5^-15
+	0xb424dc35095cd80fULL, 0x538484c19ef38c95ULL, // 5^-14
+	0xe12e13424bb40e13ULL, 0x2865a5f206b06fbaULL, // 5^-13
+	0x8cbccc096f5088cbULL, 0xf93f87b7442e45d4ULL, // 5^-12
+	0xafebff0bcb24aafeULL, 0xf78f69a51539d749ULL, // 5^-11
+	0xdbe6fecebdedd5beULL, 0xb573440e5a884d1cULL, // 5^-10
+	0x89705f4136b4a597ULL, 0x31680a88f8953031ULL, // 5^-9
+	0xabcc77118461cefcULL, 0xfdc20d2b36ba7c3eULL, // 5^-8
+	0xd6bf94d5e57a42bcULL, 0x3d32907604691b4dULL, // 5^-7
+	0x8637bd05af6c69b5ULL, 0xa63f9a49c2c1b110ULL, // 5^-6
+	0xa7c5ac471b478423ULL, 0x0fcf80dc33721d54ULL, // 5^-5
+	0xd1b71758e219652bULL, 0xd3c36113404ea4a9ULL, // 5^-4
+	0x83126e978d4fdf3bULL, 0x645a1cac083126eaULL, // 5^-3
+	0xa3d70a3d70a3d70aULL, 0x3d70a3d70a3d70a4ULL, // 5^-2
+	0xccccccccccccccccULL, 0xcccccccccccccccdULL, // 5^-1
+	0x8000000000000000ULL, 0x0000000000000000ULL, // 5^0
+	0xa000000000000000ULL, 0x0000000000000000ULL, // 5^1
+	0xc800000000000000ULL, 0x0000000000000000ULL, // 5^2
+	0xfa00000000000000ULL, 0x0000000000000000ULL, // 5^3
+	0x9c40000000000000ULL, 0x0000000000000000ULL, // 5^4
+	0xc350000000000000ULL, 0x0000000000000000ULL, // 5^5
+	0xf424000000000000ULL, 0x0000000000000000ULL, // 5^6
+	0x9896800000000000ULL, 0x0000000000000000ULL, // 5^7
+	0xbebc200000000000ULL, 0x0000000000000000ULL, // 5^8
+	0xee6b280000000000ULL, 0x0000000000000000ULL, // 5^9
+	0x9502f90000000000ULL, 0x0000000000000000ULL, // 5^10
+	0xba43b74000000000ULL, 0x0000000000000000ULL, // 5^11
+	0xe8d4a51000000000ULL, 0x0000000000000000ULL, // 5^12
+	0x9184e72a00000000ULL, 0x0000000000000000ULL, // 5^13
+	0xb5e620f480000000ULL, 0x0000000000000000ULL, // 5^14
+	0xe35fa931a0000000ULL, 0x0000000000000000ULL, // 5^15
+	0x8e1bc9bf04000000ULL, 0x0000000000000000ULL, // 5^16
+	0xb1a2bc2ec5000000ULL, 0x0000000000000000ULL, // 5^17
+	0xde0b6b3a76400000ULL, 0x0000000000000000ULL, // 5^18
+	0x8ac7230489e80000ULL, 0x0000000000000000ULL, // 5^19
+	0xad78ebc5ac620000ULL, 0x0000000000000000ULL, // 5^20
+	0xd8d726b7177a8000ULL, 0x0000000000000000ULL, // 5^21
+	0x878678326eac9000ULL, 0x0000000000000000ULL, // 5^22
+	0xa968163f0a57b400ULL, 0x0000000000000000ULL, // 5^23
+	0xd3c21bcecceda100ULL, 0x0000000000000000ULL, // 5^24
+	0x84595161401484a0ULL, 0x0000000000000000ULL, // 5^25
+	0xa56fa5b99019a5c8ULL, 0x0000000000000000ULL, // 5^26
+	0xcecb8f27f4200f3aULL, 0x0000000000000000ULL, // 5^27
+	0x813f3978f8940984ULL, 0x4000000000000000ULL, // 5^28
+	0xa18f07d736b90be5ULL, 0x5000000000000000ULL, // 5^29
+	0xc9f2c9cd04674edeULL, 0xa400000000000000ULL, // 5^30
+	0xfc6f7c4045812296ULL, 0x4d00000000000000ULL, // 5^31
+	0x9dc5ada82b70b59dULL, 0xf020000000000000ULL, // 5^32
+	0xc5371912364ce305ULL, 0x6c28000000000000ULL, // 5^33
+	0xf684df56c3e01bc6ULL, 0xc732000000000000ULL, // 5^34
+	0x9a130b963a6c115cULL, 0x3c7f400000000000ULL, // 5^35
+	0xc097ce7bc90715b3ULL, 0x4b9f100000000000ULL, // 5^36
+	0xf0bdc21abb48db20ULL, 0x1e86d40000000000ULL, // 5^37
+	0x96769950b50d88f4ULL, 0x1314448000000000ULL, // 5^38
+
+};
+
+F32 f32_from_parts(bool negative, U32 biased_exponent, U32 mantissa) {
+	U32 bits = ((U32)negative << 31) | (biased_exponent << 23) | mantissa;
+	F32 result;
+	MemoryCopy(&result, &bits, sizeof(result));
+	return result;
+}
+
+F32 string_to_f32_c_locale(char *str, int len);
+
+// Eisel-Lemire for binary32. Returns false if the result can't be decided with 128 bits of precision.
+bool eisel_lemire_f32(U64 w, S64 q, bool negative, F32 *out) {
+	if (w == 0 || q < F32_SMALLEST_POWER_OF_TEN) {
+		*out = f32_from_parts(negative, 0, 0);
+		return true;
+	}
+	if (q > F32_LARGEST_POWER_OF_TEN) {
+		*out = f32_from_parts(negative, 0xFF, 0);
+		return true;
+	}
+
+	U32 lz = count_leading_zeros(w);
+	w <<= lz;
+
+	// Multiply by the high half of 5^q and only pull in the low half when the bits below the 26 we need
+	// (23 explicit mantissa bits plus rounding) are all ones and could still carry.
+	S64 index = 2 * (q - F32_SMALLEST_POWER_OF_TEN);
+	U64 precision_mask = U64_MAX >> 26;
+	U64 high;
+	U64 low = multiply_u64_full(w, power_of_five_128[index], &high);
+	if ((high & precision_mask) == precision_mask) {
+		U64 second_high;
+		multiply_u64_full(w, power_of_five_128[index + 1], &second_high);
+		low += second_high;
+		high += (second_high > low);
+	}
+	if (low == U64_MAX) {
+		// The truncated power might have hidden a carry.
+		return false;
+	}
+
+	U32 upper_bit = (U32)(high >> 63);
+	U64 mantissa = high >> (upper_bit + 64 - 23 - 3);
+	// floor(log2(10^q)) + 63, and 127 is the exponent bias.
+	S32 power2 = (S32)((((152170 + 65536) * q) >> 16) + 63) + (S32)upper_bit - (S32)lz + 127;
+
+	if (power2 <= 0) {
+		// Subnormal
+		if (-power2 + 1 >= 64) {
+			*out = f32_from_parts(negative, 0, 0);
+			return true;
+		}
+		mantissa >>= -power2 + 1;
+		mantissa += mantissa & 1;
+		mantissa >>= 1;
+		power2 = (mantissa < (1ULL << 23)) ? 0 : 1;
+		*out = f32_from_parts(negative, (U32)power2, (U32)mantissa & ((1U << 23) - 1));
+		return true;
+	}
+
+	// Exactly halfway between two floats: round to even. This can only happen for these exponents.
+	if (low <= 1 && q >= -17 && q <= 10 && (mantissa & 3) == 1) {
+		if ((mantissa << (upper_bit + 64 - 23 - 3)) == high) {
+			mantissa &= ~1ULL;
+		}
+	}
+
+	mantissa += mantissa & 1;
+	mantissa >>= 1;
+	if (mantissa >= (2ULL << 23)) {
+		mantissa = 1ULL << 23;
+		power2 += 1;
+	}
+	mantissa &= ~(1ULL << 23);
+
+	if (power2 >= 0xFF) {
+		*out = f32_from_parts(negative, 0xFF, 0);
+	} else {
+		*out = f32_from_parts(negative, (U32)power2, (U32)mantissa);
+	}
+	return true;
+}
+
+// mantissa holds the first (at most 19) significant digits. If there were more, truncated is set and the real value
+// lies between mantissa and mantissa + 1. text is only used for the rare slow path.
+F32 decimal_to_f32(U64 mantissa, S64 exponent10, bool negative, bool truncated, char *text, int text_len) {
+	F32 result;
+	if (!truncated && mantissa <= (1ULL << 24) && exponent10 >= -10 && exponent10 <= 10) {
+		// Both operands are exact floats, so a single multiplication or division is correctly rounded.
+		static F32 powers_of_ten[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+		result = (F32)mantissa;
+		result = (exponent10 < 0) ? result / powers_of_ten[-exponent10] : result * powers_of_ten[exponent10];
+		return negative ? -result : result;
+	}
+
+	bool decided = eisel_lemire_f32(mantissa, exponent10, negative, &result);
+	if (decided && truncated) {
+		F32 upper;
+		decided = eisel_lemire_f32(mantissa + 1, exponent10, negative, &upper) && upper == result;
+	}
+	if (!decided) {
+		result = string_to_f32_c_locale(text, text_len);
+	}
+	return result;
+}
+
 void *align_forward(void *ptr, size_t alignment) {
 	uintptr_t addr = (uintptr_t)ptr;
 	uintptr_t aligned = (addr + (alignment - 1)) & ~(alignment - 1);
@@ -275,68 +761,398 @@ size_t get_aligned_size(size_t size, size_t alignment) {
 	return (size + (alignment - 1)) & ~(alignment - 1);
 }
 
+//
+// Profiler
+//
+// Scoped zones timed with the CPU's time stamp counter, compiled out unless PROFILE is defined. ProfileZone(name) adds
+// the time until the end of the enclosing scope to the zone's totals on the calling thread. Self time leaves out the
+// zones nested inside. ProfileTraceZone(name) also records every pass as an event of the Chrome trace, so it is meant
+// for phases and tasks, not for something like next_token.
+//
+// Between profile_begin() and profile_end() every thread that enters a zone gets its own totals and trace events, so
+// zones cost no synchronization. profile_print() sums the threads up, profile_write_chrome_trace() writes a file that
+// chrome://tracing and Perfetto open with one track per thread.
+#if defined(PROFILE)
+#if !defined(_MSC_VER) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+
+#define PROFILE_MAX_ZONES 64
+#define PROFILE_MAX_THREADS 256
+#define PROFILE_MAX_TRACE_EVENTS (1 << 16) // Per thread. Later events are dropped, and counted.
+
+typedef struct Profile_Zone_Totals Profile_Zone_Totals;
+struct Profile_Zone_Totals {
+	U64 hits;
+	U64 cycles;      // Outermost passes only, so recursion doesn't count twice.
+	U64 self_cycles;
+	S32 depth;
+};
+
+typedef struct Profile_Trace_Event Profile_Trace_Event;
+struct Profile_Trace_Event {
+	S32 zone;
+	U64 start;
+	U64 end;
+};
+
+typedef struct Profile_Scope Profile_Scope;
+
+typedef struct Profile_Thread Profile_Thread;
+struct Profile_Thread {
+	S32 index;
+	Profile_Scope *current;
+	Profile_Zone_Totals zones[PROFILE_MAX_ZONES];
+	Profile_Trace_Event *events;
+	S64 events_count;
+	S64 events_dropped;
+};
+
+typedef struct Profiler Profiler;
+struct Profiler {
+	char *zone_names[PROFILE_MAX_ZONES];
+	volatile S64 zones_count;
+	Profile_Thread *threads[PROFILE_MAX_THREADS];
+	volatile S64 threads_count;
+	bool tracing;
+	U64 begin_cycles, end_cycles;
+	F64 begin_seconds, end_seconds;
+};
+
+Profiler _profiler;
+thread_local Profile_Thread *_profile_thread;
+
+U64 read_cycle_counter(void) {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	// Without a time stamp counter, nanoseconds.
+	return (U64)(get_time_in_seconds() * 1e9);
+#endif
+}
+
+// Called once per zone, from the static initializer at its ProfileZone().
+S32 profile_register_zone(char *name) {
+	S64 zone = atomic_add_s64(&_profiler.zones_count, 1);
+	AssertMessage(zone < PROFILE_MAX_ZONES, "Too many profile zones, raise PROFILE_MAX_ZONES.\n");
+	_profiler.zone_names[zone] = name;
+	return (S32)zone;
+}
+
+// The calling thread's totals, made the first time it enters a zone. They live as long as the process.
+Profile_Thread *get_profile_thread(void) {
+	if (!_profile_thread) {
+		S64 index = atomic_add_s64(&_profiler.threads_count, 1);
+		AssertMessage(index < PROFILE_MAX_THREADS, "Too many profiled threads, raise PROFILE_MAX_THREADS.\n");
+		Profile_Thread *thread = (Profile_Thread*)allocate_memory(sizeof(Profile_Thread));
+		thread->index = (S32)index;
+		thread->events = (Profile_Trace_Event*)allocate_memory(sizeof(Profile_Trace_Event) * PROFILE_MAX_TRACE_EVENTS);
+		_profiler.threads[index] = thread;
+		_profile_thread = thread;
+	}
+	return _profile_thread;
+}
+
+struct Profile_Scope {
+	Profile_Thread *thread;
+	Profile_Scope *parent;
+	S32 zone;
+	bool trace;
+	U64 start;
+	U64 children_cycles;
+
+	Profile_Scope(S32 zone, bool trace) {
+		this->thread = get_profile_thread();
+		this->parent = thread->current;
+		this->zone = zone;
+		this->trace = trace;
+		this->children_cycles = 0;
+		thread->current = this;
+		thread->zones[zone].depth += 1;
+		this->start = read_cycle_counter();
+	}
+
+	~Profile_Scope() {
+		U64 end = read_cycle_counter();
+		U64 cycles = end - start;
+		Profile_Zone_Totals *totals = &thread->zones[zone];
+		totals->hits += 1;
+		totals->self_cycles += cycles - children_cycles;
+		totals->depth -= 1;
+		if (totals->depth == 0) {
+			totals->cycles += cycles;
+		}
+		if (parent) {
+			parent->children_cycles += cycles;
+		}
+		thread->current = parent;
+
+		if (trace && _profiler.tracing) {
+			if (thread->events_count < PROFILE_MAX_TRACE_EVENTS) {
+				thread->events[thread->events_count++] = {zone, start, end};
+			} else {
+				thread->events_dropped += 1;
+			}
+		}
+	}
+};
+
+#define ProfileConcat2(a, b) a##b
+#define ProfileConcat(a, b) ProfileConcat2(a, b)
+#define ProfileZoneWithTrace(name, trace) \
+	static S32 ProfileConcat(_profile_zone_, __LINE__) = profile_register_zone(name); \
+	Profile_Scope ProfileConcat(_profile_scope_, __LINE__)(ProfileConcat(_profile_zone_, __LINE__), trace)
+#define ProfileZone(name) ProfileZoneWithTrace(name, false)
+#define ProfileTraceZone(name) ProfileZoneWithTrace(name, true)
+
+// Clears the totals and events of all threads. No zone may be running on any of them.
+void profile_begin(bool trace) {
+	for (S64 i = 0; i < _profiler.threads_count; i += 1) {
+		Profile_Thread *thread = _profiler.threads[i];
+		MemoryZero(thread->zones, sizeof(thread->zones));
+		thread->events_count = 0;
+		thread->events_dropped = 0;
+	}
+	_profiler.tracing = trace;
+	_profiler.begin_seconds = get_time_in_seconds();
+	_profiler.begin_cycles = read_cycle_counter();
+}
+
+void profile_end(void) {
+	_profiler.end_cycles = read_cycle_counter();
+	_profiler.end_seconds = get_time_in_seconds();
+	_profiler.tracing = false;
+}
+
+// The counter's rate, measured over the profile against the OS clock.
+F64 get_profile_cycles_per_second(void) {
+	F64 seconds = _profiler.end_seconds - _profiler.begin_seconds;
+	return (seconds > 0.0) ? (F64)(_profiler.end_cycles - _profiler.begin_cycles) / seconds : 1.0;
+}
+
+// Prints every zone that was entered, summed over all threads, by self time. Percentages are of the time between
+// profile_begin() and profile_end(), so with several threads they can add up to more than 100.
+void profile_print(FILE *out) {
+	F64 cycles_per_ms = get_profile_cycles_per_second() / 1000.0;
+	F64 total_cycles = (F64)(_profiler.end_cycles - _profiler.begin_cycles);
+
+	Profile_Zone_Totals zones[PROFILE_MAX_ZONES] = {};
+	S32 order[PROFILE_MAX_ZONES];
+	S32 zones_count = (S32)Min(_profiler.zones_count, (S64)PROFILE_MAX_ZONES);
+	for (S32 zone = 0; zone < zones_count; zone += 1) {
+		for (S64 i = 0; i < _profiler.threads_count; i += 1) {
+			Profile_Zone_Totals *totals = &_profiler.threads[i]->zones[zone];
+			zones[zone].hits += totals->hits;
+			zones[zone].cycles += totals->cycles;
+			zones[zone].self_cycles += totals->self_cycles;
+		}
+		// Insertion sort, largest self time first.
+		S32 j = zone;
+		for (; j > 0 && zones[order[j - 1]].self_cycles < zones[zone].self_cycles; j -= 1) {
+			order[j] = order[j - 1];
+		}
+		order[j] = zone;
+	}
+
+	fprintf(out, "Profile: %.3f ms, %.2f GHz counter, %lld thread(s)\n", total_cycles / cycles_per_ms,
+	        get_profile_cycles_per_second() * 1e-9, (long long)_profiler.threads_count);
+	fprintf(out, "  %-28s %12s %12s %7s %12s %7s %12s\n", "zone", "hits", "total ms", "%", "self ms", "%", "cycles/hit");
+	for (S32 i = 0; i < zones_count; i += 1) {
+		Profile_Zone_Totals *totals = &zones[order[i]];
+		if (totals->hits == 0) {
+			continue;
+		}
+		fprintf(out, "  %-28s %12llu %12.3f %6.1f%% %12.3f %6.1f%% %12.1f\n", _profiler.zone_names[order[i]],
+		        (unsigned long long)totals->hits, totals->cycles / cycles_per_ms, 100.0 * totals->cycles / total_cycles,
+		        totals->self_cycles / cycles_per_ms, 100.0 * totals->self_cycles / total_cycles,
+		        (F64)totals->cycles / (F64)totals->hits);
+	}
+}
+
+// Writes the events of ProfileTraceZone() in the Chrome trace event format. Returns false if the file can't be written.
+bool profile_write_chrome_trace(char *file_name) {
+	FILE *out = fopen(file_name, "w");
+	if (!out) {
+		return false;
+	}
+	F64 cycles_per_us = get_profile_cycles_per_second() * 1e-6;
+	fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+	bool first = true;
+	for (S64 i = 0; i < _profiler.threads_count; i += 1) {
+		Profile_Thread *thread = _profiler.threads[i];
+		fprintf(out, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"thread %d\"}}",
+		        first ? "" : ",\n", thread->index, thread->index);
+		first = false;
+		for (S64 j = 0; j < thread->events_count; j += 1) {
+			Profile_Trace_Event *event = &thread->events[j];
+			fprintf(out, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+			        _profiler.zone_names[event->zone], thread->index,
+			        (F64)(S64)(event->start - _profiler.begin_cycles) / cycles_per_us, (F64)(event->end - event->start) / cycles_per_us);
+		}
+		if (thread->events_dropped) {
+			fprintf(stderr, "Profile: dropped %lld trace event(s) of thread %d.\n", (long long)thread->events_dropped, thread->index);
+		}
+	}
+	fprintf(out, "\n]}\n");
+	return fclose(out) == 0;
+}
+
+#else
+#define ProfileZone(name)
+#define ProfileTraceZone(name)
+#endif
+
 // Arena functions
-void arena_init(Arena *arena, S64 minimum_block_size = Megabytes(1)) {
+#define ARENA_RESERVE_SIZE Gigabytes(2)
+
+// The reservation is only address space, so arenas for big inputs can reserve far more than they will commit. It can't
+// grow once the arena is in use.
+void arena_init(Arena *arena, S64 minimum_block_size = Megabytes(1), U32 flags = ARENA_FLAG_NONE,
+                size_t reserve_size = ARENA_RESERVE_SIZE) {
 	arena->base = 0;
 	arena->size = 0;
 	arena->used = 0;
 	arena->minimum_block_size = minimum_block_size; // Must be multiple of OS page size.
+	arena->flags = flags;
+	arena->reserve_size = reserve_size;
 	// arena->temp_allocation_size = 0;
 }
 
 #define DEFAULT_ALIGNMENT (2 * sizeof(void*))
 
-void *arena_alloc(Arena *a, size_t size, size_t alignment = DEFAULT_ALIGNMENT) {
-	size = get_aligned_size(size, alignment);
-	AssertMessage((size & (alignment - 1)) == 0, "The address is not aligned.\n");
+// Like arena_alloc(), but returns NULL instead of exiting when the reservation is used up or the OS refuses memory.
+void *arena_try_alloc(Arena *a, size_t size, size_t alignment = DEFAULT_ALIGNMENT) {
+	// The base is page aligned, so aligning the offset aligns the address. Allocations with the default alignment never
+	// need padding.
+	size_t padding = get_aligned_size(a->used, alignment) - a->used;
+	size = padding + get_aligned_size(size, alignment);
 
-	void *memory;
-	if (a->used + size > a->size) {
+	bool large_pages = IsEnabled(a->flags & ARENA_FLAG_LARGE_PAGES);
+
+	// The minimum amount of memory one can commit is a single page. Large page arenas commit whole large pages so that
+	// every block can be backed by them.
+	U32 page_size = get_page_size(); // Windows typically uses 4K pages
+	size_t granularity = large_pages ? get_large_page_size() : page_size;
+
+	if (!a->base) {
+		a->reserve_size = get_aligned_size(a->reserve_size ? a->reserve_size : ARENA_RESERVE_SIZE, granularity);
+		a->base = (U8*)reserve_memory(a->reserve_size, large_pages);
 		if (!a->base) {
-			a->base = (U8*)reserve_memory(Gigabytes(2));
-			if (!a->base) {
-				printf("Fatal: Failed to reserve 2 GiB of virtual memory.\n");
-				exit_process(1);
-			}
-			// printf("Reserved 2 GiB of virtual address space.\n");
+			return NULL;
 		}
+		// printf("Reserved %zu MiB of virtual address space.\n", a->reserve_size / (1024 * 1024));
+	}
+	if (size > a->reserve_size - a->used) {
+		return NULL;
+	}
 
-		// The minimum amount of memory one can allocate with VirtualAlloc is a single page.
-		U32 page_size = get_page_size(); // Windows typically uses 4K pages
+	void *memory;
+	if (a->used + size > a->size) {
 		AssertMessage(a->minimum_block_size > 0 && (a->minimum_block_size % page_size) == 0, 
 		              "The minimum block size is not a multiple of the OS page size.\n");
 
-		size_t block_size;
-		if (size > a->minimum_block_size) {
-			if (size % page_size == 0)
-				block_size = size;
-			else
-				block_size = next_multiple_of(page_size, size);
-		} else {
-			block_size = a->minimum_block_size;
+		// Blocks are committed back to back, starting where the last one ended. The last one may be cut short by the
+		// end of the reservation.
+		size_t needed = a->used + size - a->size;
+		size_t block_size = Max(needed, a->minimum_block_size);
+		if (block_size % granularity != 0) {
+			block_size = next_multiple_of(granularity, block_size);
 		}
+		block_size = Min(block_size, a->reserve_size - a->size);
 
-		void *result = commit_memory(a->base + a->used, block_size);
+		ProfileZone("arena_commit");
+		void *result = commit_memory(a->base + a->size, block_size, large_pages);
 		if (!result) {
-			printf("Fatal: Failed to commit a memory block of size %llu.\n", block_size);
-			exit_process(1);
+			return NULL;
 		}
 
-		//printf("Committed %llu MiB of virtual memory.\n", block_size / (1024 * 1024));
+		//printf("Committed %zu MiB of virtual memory.\n", block_size / (1024 * 1024));
 
 		a->size += block_size;
+		S64 committed = atomic_add_s64(&_arena_committed, (S64)block_size) + (S64)block_size;
+		for (S64 peak = _arena_peak_committed; committed > peak;) {
+			peak = atomic_compare_exchange_s64(&_arena_peak_committed, peak, committed);
+		}
 	}
 
-	memory = a->base + a->used;
+	memory = a->base + a->used + padding;
 	a->used += size;
+	AssertMessage(((size_t)memory & (alignment - 1)) == 0, "The address is not aligned.\n");
+
+	return memory;
+}
+
+void arena_out_of_memory(Arena *a, size_t size) {
+	printf("Fatal: Arena could not allocate %zu bytes. It reserved %zu MiB and committed %zu MiB.\n", size,
+	       a->reserve_size / (1024 * 1024), a->size / (1024 * 1024));
+	exit_process(1);
+}
 
+void *arena_alloc(Arena *a, size_t size, size_t alignment = DEFAULT_ALIGNMENT) {
+	void *memory = arena_try_alloc(a, size, alignment);
+	if (!memory) {
+		arena_out_of_memory(a, size);
+	}
 	return memory;
 }
 
+// Like arena_realloc(), but returns NULL and leaves the allocation as it was if the arena can't provide the memory.
+void *arena_try_realloc(Arena *a, void *memory, size_t size, size_t new_size) {
+	if (!memory) {
+		return arena_try_alloc(a, new_size);
+	}
+	size_t aligned_size = get_aligned_size(size, DEFAULT_ALIGNMENT);
+	if ((U8*)memory + aligned_size == a->base + a->used) {
+		if (new_size > size && !arena_try_alloc(a, get_aligned_size(new_size, DEFAULT_ALIGNMENT) - aligned_size)) {
+			return NULL;
+		}
+		return memory;
+	}
+	void *result = arena_try_alloc(a, new_size);
+	if (result) {
+		MemoryCopy(result, memory, Min(size, new_size));
+	}
+	return result;
+}
+
+// Resizes an allocation to new_size bytes. The memory of an arena never moves, so the last allocation grows in place
+// and only commits more pages. Anything else is copied to a new allocation.
+void *arena_realloc(Arena *a, void *memory, size_t size, size_t new_size) {
+	void *result = arena_try_realloc(a, memory, size, new_size);
+	if (!result) {
+		arena_out_of_memory(a, new_size);
+	}
+	return result;
+}
+
 void arena_free_all(Arena *a) {
 	a->used = 0;
 }
 
+// Gives the arena's memory back to the OS. The arena can be used again afterwards.
+void arena_release(Arena *a) {
+	if (a->base) {
+		release_memory(a->base, a->reserve_size);
+		atomic_add_s64(&_arena_committed, -(S64)a->size);
+	}
+	a->base = 0;
+	a->size = 0;
+	a->used = 0;
+}
+
+S64 get_arena_committed_memory(void) {
+	return _arena_committed;
+}
+
+// The most memory the arenas had committed at once since the last reset.
+S64 get_arena_peak_committed_memory(void) {
+	return _arena_peak_committed;
+}
+
+void reset_arena_peak_committed_memory(void) {
+	atomic_exchange_s64(&_arena_peak_committed, _arena_committed);
+}
+
 // Scratch arena
 Arena *begin_scratch(void) {
 	return &_scratch;
@@ -346,6 +1162,101 @@ void end_scratch(Arena *scratch) {
 	arena_free_all(scratch);
 }
 
+//
+// Thread pool
+//
+// A fixed set of worker threads that run one batch of tasks at a time. thread_pool_run() hands out task indices
+// 0..task_count-1 to the workers and to the calling thread, and returns once all of them are done.
+//
+// NOTE(Jan): thread_pool_run() also waits for every worker it woke to leave the batch, even those that arrive after
+// the last task was taken. No worker is ever inside a batch while the next one is set up, so a late worker can't take
+// an index of an old batch into a new one, and every wake-up is used up by the batch it was meant for.
+typedef void Thread_Task_Proc(void *data, S64 task_index);
+
+typedef struct Thread_Pool Thread_Pool;
+struct Thread_Pool {
+	S32 worker_count;
+	void *work_available;
+	void *all_done;
+
+	// Current batch. Published with release stores before the workers are woken, read with acquire loads.
+	void *volatile proc; // Thread_Task_Proc
+	void *volatile data;
+	volatile S64 task_count;
+	volatile S64 next_task;
+	volatile S64 threads_active; // The woken workers and the calling thread that haven't left the batch yet.
+};
+
+Thread_Pool _thread_pool;
+
+void thread_pool_do_tasks(Thread_Pool *pool) {
+	Thread_Task_Proc *proc = (Thread_Task_Proc*)atomic_load_acquire_pointer(&pool->proc);
+	void *data = atomic_load_acquire_pointer(&pool->data);
+	S64 task_count = atomic_load_acquire_s64(&pool->task_count);
+	for (;;) {
+		S64 task_index = atomic_add_s64(&pool->next_task, 1);
+		if (task_index >= task_count) {
+			break;
+		}
+		proc(data, task_index);
+	}
+	// The last thread to leave ends the batch.
+	if (atomic_add_s64(&pool->threads_active, -1) == 1) {
+		semaphore_signal(pool->all_done, 1);
+	}
+}
+
+void thread_pool_worker(void *parameter) {
+	Thread_Pool *pool = (Thread_Pool*)parameter;
+	for (;;) {
+		semaphore_wait(pool->work_available);
+		thread_pool_do_tasks(pool);
+	}
+}
+
+void thread_pool_init(Thread_Pool *pool, S32 worker_count) {
+	MemoryZero(pool, sizeof(*pool));
+	pool->work_available = make_semaphore(0);
+	pool->all_done = make_semaphore(0);
+	for (S32 i = 0; i < worker_count; i += 1) {
+		if (create_thread(thread_pool_worker, pool)) {
+			pool->worker_count += 1;
+		}
+	}
+}
+
+// The pool shared by everything in the process, with one worker per additional processor.
+Thread_Pool *get_thread_pool(void) {
+	if (!_thread_pool.work_available) {
+		thread_pool_init(&_thread_pool, get_processor_count() - 1);
+	}
+	return &_thread_pool;
+}
+
+// Without a pool the tasks run one after the other on the calling thread.
+void thread_pool_run(Thread_Pool *pool, S64 task_count, Thread_Task_Proc *proc, void *data) {
+	if (task_count <= 0) {
+		return;
+	}
+	if (!pool) {
+		for (S64 i = 0; i < task_count; i += 1) {
+			proc(data, i);
+		}
+		return;
+	}
+	// No worker is inside the pool here (see the note above), so nothing reads the batch while it is set up.
+	S64 woken = Min((S64)pool->worker_count, task_count - 1);
+	atomic_store_release_pointer(&pool->proc, (void*)proc);
+	atomic_store_release_pointer(&pool->data, data);
+	atomic_store_release_s64(&pool->task_count, task_count);
+	atomic_store_release_s64(&pool->threads_active, woken + 1);
+	atomic_store_release_s64(&pool->next_task, 0);
+
+	semaphore_signal(pool->work_available, (U32)woken);
+	thread_pool_do_tasks(pool);
+	semaphore_wait(pool->all_done);
+}
+
 // Hashing function which is effective for ASCII strings: djb2
 U64 hash_ascii(char *string) {
 	U64 hash = 5381;
@@ -364,14 +1275,85 @@ U64 hash_ascii(char *string, S64 length) {
 	return hash;
 }
 
+// Hashing function for large amounts of binary data. Four independent lanes of 8 byte words keep the multipliers busy,
+// in the style of xxHash64.
+#define HASH_PRIME_1 0x9E3779B185EBCA87ULL
+#define HASH_PRIME_2 0xC2B2AE3D27D4EB4FULL
+#define HASH_PRIME_3 0x165667B19E3779F9ULL
+
+U64 rotate_left_u64(U64 x, int amount) {
+	return (x << amount) | (x >> (64 - amount));
+}
+
+U64 hash_round(U64 lane, U64 word) {
+	return rotate_left_u64(lane + word * HASH_PRIME_2, 31) * HASH_PRIME_1;
+}
+
+U64 hash_bytes(void *data, size_t len, U64 seed = 0) {
+	U8 *at = (U8*)data;
+	U8 *end = at + len;
+	U64 hash = seed + HASH_PRIME_3 + len;
+
+	if (len >= 32) {
+		U64 lanes[4] = {seed + HASH_PRIME_1 + HASH_PRIME_2, seed + HASH_PRIME_2, seed, seed - HASH_PRIME_1};
+		for (; end - at >= 32; at += 32) {
+			U64 words[4];
+			MemoryCopy(words, at, 32);
+			lanes[0] = hash_round(lanes[0], words[0]);
+			lanes[1] = hash_round(lanes[1], words[1]);
+			lanes[2] = hash_round(lanes[2], words[2]);
+			lanes[3] = hash_round(lanes[3], words[3]);
+		}
+		hash += rotate_left_u64(lanes[0], 1) + rotate_left_u64(lanes[1], 7) + rotate_left_u64(lanes[2], 12) + rotate_left_u64(lanes[3], 18);
+		for (int i = 0; i < 4; i += 1) {
+			hash = (hash ^ hash_round(0, lanes[i])) * HASH_PRIME_1 + HASH_PRIME_3;
+		}
+	}
+	for (; end - at >= 8; at += 8) {
+		U64 word;
+		MemoryCopy(&word, at, 8);
+		hash = rotate_left_u64(hash ^ hash_round(0, word), 27) * HASH_PRIME_1 + HASH_PRIME_3;
+	}
+	for (; at < end; at += 1) {
+		hash = rotate_left_u64(hash ^ (*at * HASH_PRIME_3), 11) * HASH_PRIME_1;
+	}
+
+	hash ^= hash >> 33;
+	hash *= HASH_PRIME_2;
+	hash ^= hash >> 29;
+	hash *= HASH_PRIME_3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+// Joins a directory and a file name into a new string in the arena.
+char *make_path(Arena *arena, char *directory, char *name) {
+	size_t directory_len = strlen(directory);
+	size_t name_len = strlen(name);
+	char *path = (char*)arena_alloc(arena, directory_len + name_len + 2);
+	MemoryCopy(path, directory, directory_len);
+	path[directory_len] = '/';
+	MemoryCopy(path + directory_len + 1, name, name_len + 1);
+	return path;
+}
+
+bool has_extension(char *name, char *extension) {
+	size_t name_len = strlen(name);
+	size_t extension_len = strlen(extension);
+	return name_len > extension_len && 0 == strcmp(name + name_len - extension_len, extension);
+}
+
+int compare_paths(const void *a, const void *b) {
+	return strcmp(*(char**)a, *(char**)b);
+}
+
 //
 // OS specific functions
 
 #if defined(_WIN32)
 #include <windows.h>
-#else
-#error Other OSs are currently not supported.
-#endif
+#include <locale.h>
+#include <malloc.h>
 
 double get_time_in_seconds(void) {
 	LARGE_INTEGER c, f;
@@ -384,32 +1366,161 @@ void *allocate_memory(size_t size) {
 	return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
 }
 
-void *reserve_memory(size_t size) {
+void release_memory(void *memory, size_t size) {
+	VirtualFree(memory, 0, MEM_RELEASE);
+}
+
+// NOTE: Windows only hands out large pages for memory that is reserved and committed in one go (MEM_LARGE_PAGES) and
+// requires SeLockMemoryPrivilege, which does not fit the reserve-then-commit arena. The flag is ignored here.
+void *reserve_memory(size_t size, bool large_pages) {
 	return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_READWRITE);
 }
 
-void *commit_memory(void *memory, size_t size) {
+void *commit_memory(void *memory, size_t size, bool large_pages) {
 	return VirtualAlloc(memory, size, MEM_COMMIT, PAGE_READWRITE);
 }
 
 File read_file(Arena *arena, char *path_to_file) {
+	ProfileTraceZone("read_file");
 	File file = {};
-	HANDLE file_handle = CreateFile(path_to_file, GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	HANDLE file_handle = CreateFile(path_to_file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
 	if (file_handle != INVALID_HANDLE_VALUE) {
 		LARGE_INTEGER large_int;
 		GetFileSizeEx(file_handle, &large_int);
-		Assert(large_int.QuadPart < S32_MAX); // TODO(Jan): Handle bigger files than S32_MAX.
-		int file_size = (int)large_int.QuadPart;
-		file.data = (U8*)arena_alloc(arena, file_size);
-		file.success = ReadFile(file_handle, file.data, file_size, (DWORD*)&file.len, NULL);
+		size_t file_size = (size_t)large_int.QuadPart;
+		// Files that don't fit into what is left of the arena's reservation fail like unreadable ones.
+		file.data = (U8*)arena_try_alloc(arena, file_size);
+		file.success = file.data != NULL;
+		// ReadFile takes a DWORD, so files bigger than 4 GiB are read in pieces.
+		while (file.success && file.len < file_size) {
+			DWORD bytes_to_read = (DWORD)Min(file_size - file.len, (size_t)Gigabytes(1));
+			DWORD bytes_read = 0;
+			file.success = ReadFile(file_handle, file.data + file.len, bytes_to_read, &bytes_read, NULL) && bytes_read > 0;
+			file.len += bytes_read;
+		}
 		if (!file.success) {
 			file.data = (U8*)"";
 			file.len = 0;
 		}
+		CloseHandle(file_handle);
 	}
 	return file;
 }
 
+File map_file(char *path_to_file) {
+	ProfileTraceZone("map_file");
+	File file = {};
+	HANDLE file_handle = CreateFile(path_to_file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file_handle != INVALID_HANDLE_VALUE) {
+		LARGE_INTEGER large_int;
+		GetFileSizeEx(file_handle, &large_int);
+		if (large_int.QuadPart == 0) {
+			// Empty files can't be mapped.
+			file.success = true;
+		} else {
+			HANDLE mapping = CreateFileMapping(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (mapping) {
+				void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				if (view) {
+					file.data = (U8*)view;
+					file.len = (size_t)large_int.QuadPart;
+					file.mapped = true;
+					file.success = true;
+				}
+				// The view keeps the mapping alive.
+				CloseHandle(mapping);
+			}
+		}
+		CloseHandle(file_handle);
+	}
+	return file;
+}
+
+void unmap_file(File *file) {
+	if (file->mapped) {
+		UnmapViewOfFile(file->data);
+	}
+	file->data = (U8*)"";
+	file->len = 0;
+	file->mapped = false;
+}
+
+bool write_file(char *path_to_file, void *data, size_t len) {
+	bool success = false;
+	HANDLE file_handle = CreateFile(path_to_file, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file_handle != INVALID_HANDLE_VALUE) {
+		size_t written = 0;
+		success = true;
+		while (success && written < len) {
+			DWORD bytes_to_write = (DWORD)Min(len - written, (size_t)Gigabytes(1));
+			DWORD bytes_written = 0;
+			success = WriteFile(file_handle, (U8*)data + written, bytes_to_write, &bytes_written, NULL) && bytes_written > 0;
+			written += bytes_written;
+		}
+		CloseHandle(file_handle);
+	}
+	return success;
+}
+
+// Returns 0 if the file doesn't exist.
+U64 get_file_modified_time(char *path_to_file) {
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesEx(path_to_file, GetFileExInfoStandard, &attributes)) {
+		return 0;
+	}
+	return ((U64)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+}
+
+// Returns 0 if the file doesn't exist.
+U64 get_file_size(char *path_to_file) {
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesEx(path_to_file, GetFileExInfoStandard, &attributes)) {
+		return 0;
+	}
+	return ((U64)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+}
+
+// Returns the paths of the regular files in the directory whose names end in the extension, sorted by name.
+char **list_files(Arena *arena, char *directory, char *extension, S64 *count) {
+	char *pattern = make_path(arena, directory, "*");
+	WIN32_FIND_DATA find_data;
+	S64 files_count = 0;
+	// The first pass counts, the second one collects.
+	char **files = NULL;
+	for (S32 pass = 0; pass < 2; pass += 1) {
+		if (pass == 1) {
+			files = (char**)arena_alloc(arena, sizeof(char*) * Max(files_count, 1));
+			files_count = 0;
+		}
+		HANDLE find = FindFirstFile(pattern, &find_data);
+		if (find == INVALID_HANDLE_VALUE) {
+			break;
+		}
+		do {
+			if (!(find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && has_extension(find_data.cFileName, extension)) {
+				if (pass == 1) {
+					files[files_count] = make_path(arena, directory, find_data.cFileName);
+				}
+				files_count += 1;
+			}
+		} while (FindNextFile(find, &find_data));
+		FindClose(find);
+	}
+	if (files) {
+		qsort(files, files_count, sizeof(char*), compare_paths);
+	}
+	*count = files_count;
+	return files;
+}
+
+F32 string_to_f32_c_locale(char *str, int len) {
+	static _locale_t c_locale = _create_locale(LC_NUMERIC, "C");
+	char *null_terminated_str = (char*)_alloca(len + 1);
+	MemoryCopy(null_terminated_str, str, len);
+	null_terminated_str[len] = '\0';
+	return _strtof_l(null_terminated_str, NULL, c_locale);
+}
+
 void notification_window(char *title, char *text) {
 	MessageBox(NULL, text, title, MB_ICONEXCLAMATION);
 }
@@ -433,6 +1544,57 @@ U32 get_page_size(void) {
 	return (U32)system_info.dwPageSize;
 }
 
+size_t get_large_page_size(void) {
+	// Large pages are not used on Windows (see reserve_memory), so commit with the regular granularity.
+	return get_page_size();
+}
+
+S32 get_processor_count(void) {
+	SYSTEM_INFO system_info;
+	GetSystemInfo(&system_info);
+	return (S32)system_info.dwNumberOfProcessors;
+}
+
+typedef struct Thread_Start Thread_Start;
+struct Thread_Start {
+	Thread_Proc *proc;
+	void *parameter;
+};
+
+DWORD WINAPI thread_start(LPVOID parameter) {
+	Thread_Start start = *(Thread_Start*)parameter;
+	VirtualFree(parameter, 0, MEM_RELEASE);
+	start.proc(start.parameter);
+	return 0;
+}
+
+bool create_thread(Thread_Proc *proc, void *parameter) {
+	Thread_Start *start = (Thread_Start*)allocate_memory(sizeof(Thread_Start));
+	start->proc = proc;
+	start->parameter = parameter;
+	HANDLE thread = CreateThread(NULL, 0, thread_start, start, 0, NULL);
+	if (!thread) {
+		VirtualFree(start, 0, MEM_RELEASE);
+		return false;
+	}
+	CloseHandle(thread);
+	return true;
+}
+
+void *make_semaphore(U32 initial_count) {
+	return CreateSemaphore(NULL, initial_count, MAXLONG, NULL);
+}
+
+void semaphore_signal(void *semaphore, U32 count) {
+	if (count > 0) {
+		ReleaseSemaphore((HANDLE)semaphore, count, NULL);
+	}
+}
+
+void semaphore_wait(void *semaphore) {
+	WaitForSingleObject((HANDLE)semaphore, INFINITE);
+}
+
 // void debug_print_format(char *format, ...) {
 // 	va_list args;
 // 	va_start(args, format);
@@ -448,3 +1610,336 @@ U32 get_page_size(void) {
 
 // 	va_end(args);
 // }
+
+#elif defined(__linux__) || defined(__APPLE__)
+
+#include <alloca.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <locale.h>
+#include <sys/mman.h>
+#if defined(__APPLE__)
+#include <xlocale.h>
+#endif
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+double get_time_in_seconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void *allocate_memory(size_t size) {
+	void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	return memory == MAP_FAILED ? NULL : memory;
+}
+
+// Reserving maps the range without any access rights. MAP_NORESERVE keeps the kernel from charging the whole range
+// against the commit limit; pages only become usable once commit_memory() has changed their protection.
+// Large page reservations are aligned to the large page size so that every committed block can be backed by them.
+void *reserve_memory(size_t size, bool large_pages) {
+	size_t alignment = large_pages ? get_large_page_size() : 0;
+	U8 *memory = (U8*)mmap(NULL, size + alignment, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (memory == (U8*)MAP_FAILED) {
+		return NULL;
+	}
+	if (alignment) {
+		U8 *aligned = (U8*)align_forward(memory, alignment);
+		if (aligned > memory) {
+			munmap(memory, aligned - memory);
+		}
+		munmap(aligned + size, (memory + alignment) - aligned);
+		memory = aligned;
+	}
+	return memory;
+}
+
+void release_memory(void *memory, size_t size) {
+	munmap(memory, size);
+}
+
+void *commit_memory(void *memory, size_t size, bool large_pages) {
+#if defined(__linux__)
+	if (large_pages) {
+		// Try explicit huge pages from the hugetlb pool first. If the pool can't serve the request the range has to be
+		// turned back into a plain reservation before falling back to transparent huge pages.
+		void *result = mmap(memory, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB, -1, 0);
+		if (result != MAP_FAILED) {
+			return result;
+		}
+		result = mmap(memory, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0);
+		if (result == MAP_FAILED) {
+			return NULL;
+		}
+	}
+#endif
+	if (mprotect(memory, size, PROT_READ | PROT_WRITE) != 0) {
+		return NULL;
+	}
+#if defined(__linux__)
+	if (large_pages) {
+		madvise(memory, size, MADV_HUGEPAGE);
+	}
+#endif
+	return memory;
+}
+
+File read_file(Arena *arena, char *path_to_file) {
+	ProfileTraceZone("read_file");
+	File file = {};
+	int fd = open(path_to_file, O_RDONLY);
+	if (fd != -1) {
+		struct stat st;
+		if (fstat(fd, &st) == 0) {
+			size_t file_size = (size_t)st.st_size;
+			// Files that don't fit into what is left of the arena's reservation fail like unreadable ones.
+			file.data = (U8*)arena_try_alloc(arena, file_size);
+			file.success = file.data != NULL;
+			// read() may return less than asked for, so keep going until the whole file is in.
+			while (file.success && file.len < file_size) {
+				ssize_t bytes_read = read(fd, file.data + file.len, file_size - file.len);
+				if (bytes_read <= 0) {
+					file.success = false;
+					break;
+				}
+				file.len += (size_t)bytes_read;
+			}
+		}
+		if (!file.success) {
+			file.data = (U8*)"";
+			file.len = 0;
+		}
+		close(fd);
+	}
+	return file;
+}
+
+File map_file(char *path_to_file) {
+	ProfileTraceZone("map_file");
+	File file = {};
+	int fd = open(path_to_file, O_RDONLY);
+	if (fd != -1) {
+		struct stat st;
+		if (fstat(fd, &st) == 0) {
+			if (st.st_size == 0) {
+				// Empty files can't be mapped.
+				file.success = true;
+			} else {
+				void *memory = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (memory != MAP_FAILED) {
+					// The file is walked front to back exactly once: ask for aggressive read-ahead and early reclaim.
+					madvise(memory, (size_t)st.st_size, MADV_SEQUENTIAL);
+					madvise(memory, (size_t)st.st_size, MADV_WILLNEED);
+					file.data = (U8*)memory;
+					file.len = (size_t)st.st_size;
+					file.mapped = true;
+					file.success = true;
+				}
+			}
+		}
+		// The mapping stays valid after the descriptor is closed.
+		close(fd);
+	}
+	return file;
+}
+
+void unmap_file(File *file) {
+	if (file->mapped) {
+		munmap(file->data, file->len);
+	}
+	file->data = (U8*)"";
+	file->len = 0;
+	file->mapped = false;
+}
+
+bool write_file(char *path_to_file, void *data, size_t len) {
+	bool success = false;
+	int fd = open(path_to_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd != -1) {
+		size_t written = 0;
+		success = true;
+		while (written < len) {
+			ssize_t bytes_written = write(fd, (U8*)data + written, len - written);
+			if (bytes_written <= 0) {
+				success = false;
+				break;
+			}
+			written += (size_t)bytes_written;
+		}
+		success = (close(fd) == 0) && success;
+	}
+	return success;
+}
+
+// Returns 0 if the file doesn't exist. In nanoseconds.
+U64 get_file_modified_time(char *path_to_file) {
+	struct stat st;
+	if (stat(path_to_file, &st) != 0) {
+		return 0;
+	}
+#if defined(__APPLE__)
+	return (U64)st.st_mtimespec.tv_sec * 1000000000ULL + (U64)st.st_mtimespec.tv_nsec;
+#else
+	return (U64)st.st_mtim.tv_sec * 1000000000ULL + (U64)st.st_mtim.tv_nsec;
+#endif
+}
+
+// Returns 0 if the file doesn't exist.
+U64 get_file_size(char *path_to_file) {
+	struct stat st;
+	if (stat(path_to_file, &st) != 0) {
+		return 0;
+	}
+	return (U64)st.st_size;
+}
+
+// Returns the paths of the regular files in the directory whose names end in the extension, sorted by name.
+char **list_files(Arena *arena, char *directory, char *extension, S64 *count) {
+	S64 files_count = 0;
+	char **files = NULL;
+	DIR *dir = opendir(directory);
+	if (dir) {
+		// The first pass counts, the second one collects.
+		for (S32 pass = 0; pass < 2; pass += 1) {
+			if (pass == 1) {
+				files = (char**)arena_alloc(arena, sizeof(char*) * Max(files_count, 1));
+				files_count = 0;
+				rewinddir(dir);
+			}
+			for (struct dirent *entry = readdir(dir); entry; entry = readdir(dir)) {
+				if (!has_extension(entry->d_name, extension)) {
+					continue;
+				}
+				char *path = make_path(arena, directory, entry->d_name);
+				struct stat st;
+				if (stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+					if (pass == 1) {
+						files[files_count] = path;
+					}
+					files_count += 1;
+				}
+			}
+		}
+		closedir(dir);
+		qsort(files, files_count, sizeof(char*), compare_paths);
+	}
+	*count = files_count;
+	return files;
+}
+
+F32 string_to_f32_c_locale(char *str, int len) {
+	static locale_t c_locale = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+	char *null_terminated_str = (char*)alloca(len + 1);
+	MemoryCopy(null_terminated_str, str, len);
+	null_terminated_str[len] = '\0';
+	return strtof_l(null_terminated_str, NULL, c_locale);
+}
+
+void notification_window(char *title, char *text) {
+	fprintf(stderr, "%s: %s\n", title, text);
+}
+
+void exit_process(int return_code) {
+	exit(return_code);
+}
+
+U32 get_page_size(void) {
+	return (U32)sysconf(_SC_PAGESIZE);
+}
+
+size_t get_large_page_size(void) {
+	static size_t large_page_size = 0;
+	if (!large_page_size) {
+		large_page_size = Megabytes(2);
+#if defined(__linux__)
+		FILE *f = fopen("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r");
+		if (f) {
+			unsigned long long value = 0;
+			if (fscanf(f, "%llu", &value) == 1 && value > 0 && is_power_of_two((uintptr_t)value)) {
+				large_page_size = (size_t)value;
+			}
+			fclose(f);
+		}
+#endif
+	}
+	return large_page_size;
+}
+
+S32 get_processor_count(void) {
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? (S32)count : 1;
+}
+
+typedef struct Thread_Start Thread_Start;
+struct Thread_Start {
+	Thread_Proc *proc;
+	void *parameter;
+};
+
+void *thread_start(void *parameter) {
+	Thread_Start start = *(Thread_Start*)parameter;
+	free(parameter);
+	start.proc(start.parameter);
+	return NULL;
+}
+
+bool create_thread(Thread_Proc *proc, void *parameter) {
+	Thread_Start *start = (Thread_Start*)malloc(sizeof(Thread_Start));
+	start->proc = proc;
+	start->parameter = parameter;
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, thread_start, start) != 0) {
+		free(start);
+		return false;
+	}
+	pthread_detach(thread);
+	return true;
+}
+
+// Unnamed POSIX semaphores aren't available on macOS, so this is a counting semaphore built from a mutex and a
+// condition variable.
+typedef struct Semaphore Semaphore;
+struct Semaphore {
+	pthread_mutex_t mutex;
+	pthread_cond_t condition;
+	U32 count;
+};
+
+void *make_semaphore(U32 initial_count) {
+	Semaphore *semaphore = (Semaphore*)malloc(sizeof(Semaphore));
+	pthread_mutex_init(&semaphore->mutex, NULL);
+	pthread_cond_init(&semaphore->condition, NULL);
+	semaphore->count = initial_count;
+	return semaphore;
+}
+
+void semaphore_signal(void *semaphore_handle, U32 count) {
+	Semaphore *semaphore = (Semaphore*)semaphore_handle;
+	if (count > 0) {
+		pthread_mutex_lock(&semaphore->mutex);
+		semaphore->count += count;
+		if (count == 1) {
+			pthread_cond_signal(&semaphore->condition);
+		} else {
+			pthread_cond_broadcast(&semaphore->condition);
+		}
+		pthread_mutex_unlock(&semaphore->mutex);
+	}
+}
+
+void semaphore_wait(void *semaphore_handle) {
+	Semaphore *semaphore = (Semaphore*)semaphore_handle;
+	pthread_mutex_lock(&semaphore->mutex);
+	while (semaphore->count == 0) {
+		pthread_cond_wait(&semaphore->condition, &semaphore->mutex);
+	}
+	semaphore->count -= 1;
+	pthread_mutex_unlock(&semaphore->mutex);
+}
+
+#else
+#error Other OSs are currently not supported.
+#endif
@@ -142,9 +142,12 @@ F32 table[TABLE_SIZE] = {
 //
 // Basic math operations.
 F32 sqrt_f32(F32 value);
+F32 atan2_f32(F32 y, F32 x);
 F32 ceil_f32(F32 value);
 F32 floor_f32(F32 value);
 F32 round_f32(F32 val);
+U16 f32_to_f16(F32 value);
+F32 f16_to_f32(U16 value);
 
 //
 // Trigonometric functions
@@ -219,6 +222,10 @@ F32 sqrt_f32(F32 value) {
     return sqrtf(value);
 }
 
+F32 atan2_f32(F32 y, F32 x) {
+    return atan2f(y, x);
+}
+
 F32 ceil_f32(F32 value) {
     int truncated = (int)value;
     return (F32)(truncated + (value > truncated));
@@ -236,6 +243,52 @@ F32 round_f32(F32 val) {
     return (F32)(int)(val + half * Sign(val));
 }
 
+// Rounds to the nearest half float, ties to even. Too large values become infinity.
+U16 f32_to_f16(F32 value) {
+    U32 bits;
+    MemoryCopy(&bits, &value, sizeof(bits));
+    U32 sign = (bits >> 16) & 0x8000;
+    bits &= 0x7fffffff;
+
+    U16 half;
+    if (bits >= 0x47800000) {
+        half = (bits > 0x7f800000) ? 0x7e00 : 0x7c00;
+    } else if (bits < 0x38800000) {
+        // Subnormal: adding 0.5 lets the float hardware do the rounding into the low mantissa bits.
+        F32 magic = 0.5f;
+        F32 sum;
+        MemoryCopy(&sum, &bits, sizeof(sum));
+        sum += magic;
+        MemoryCopy(&bits, &sum, sizeof(bits));
+        half = (U16)(bits - 0x3f000000);
+    } else {
+        U32 mantissa_odd = (bits >> 13) & 1;
+        bits += 0xc8000fff + mantissa_odd; // Rebias the exponent from 127 to 15 and round.
+        half = (U16)(bits >> 13);
+    }
+    return (U16)(half | sign);
+}
+
+F32 f16_to_f32(U16 value) {
+    U32 sign = (U32)(value & 0x8000) << 16;
+    U32 exponent = (value >> 10) & 0x1f;
+    U32 mantissa = value & 0x3ff;
+
+    U32 bits;
+    if (exponent == 0) {
+        F32 subnormal = (F32)mantissa * (1.0f / 16777216.0f);
+        MemoryCopy(&bits, &subnormal, sizeof(bits));
+        bits |= sign;
+    } else if (exponent == 31) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    F32 result;
+    MemoryCopy(&result, &bits, sizeof(result));
+    return result;
+}
+
 //
 // trigonometric functions
 F32 sin_f32(F32 turn) {
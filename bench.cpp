@@ -0,0 +1,212 @@
+#include "basic.cpp"
+#include "basic_math.cpp"
+#include "parser.cpp"
+#include "obj_generator.cpp"
+
+// Measures parse() end to end on every obj file in ../res and on files from obj_generator.cpp, and writes the results as JSON so
+// that runs from different commits can be diffed.
+//
+//   bench [options] [file.obj ...]    Run from inside bin/ like parse. Files replace ../res/*.obj.
+//     --runs N        Measured parses per file and configuration (default 10).
+//     --warmup N      Parses before measuring, to warm the page cache and the thread pool (default 2).
+//     --lines N       Lines of each generated file, 0 to leave them out (default 1000000).
+//     --out FILE      Write the JSON to FILE instead of stdout.
+//
+// Every parse gets a fresh arena, and the peak is the most memory all arenas had committed at once during it. Faces
+// are the triangles of the scene. Files that fail to parse are still measured, with success set to false.
+
+#define BENCH_DEFAULT_RUNS 10
+#define BENCH_DEFAULT_WARMUP 2
+#define BENCH_DEFAULT_LINES 1000000
+
+typedef struct Bench_Config Bench_Config;
+struct Bench_Config {
+	char *name;
+	U32 flags;
+};
+
+Bench_Config bench_configs[] = {
+	{"serial", PARSE_FLAG_NONE},
+	{"multithreaded", PARSE_FLAG_MULTITHREADED},
+	{"multithreaded_mapped", PARSE_FLAG_MULTITHREADED | PARSE_FLAG_MAP_FILE},
+};
+
+// Generated inputs, written next to the executable. They differ in what the tokenizer and the deduplication see.
+typedef struct Bench_Input Bench_Input;
+struct Bench_Input {
+	char *file_name;
+	U32 face_style;
+	F32 tex_coords_ratio;
+	F32 normals_ratio;
+	F32 exponent_ratio;
+	F32 comment_ratio;
+};
+
+Bench_Input bench_inputs[] = {
+	{"bench_v_vt_vn.obj", OBJ_GENERATOR_FACE_V_VT_VN, 1.0f, 1.0f, 0.0f, 0.0f},
+	{"bench_v.obj", OBJ_GENERATOR_FACE_V, 0.0f, 0.0f, 0.0f, 0.0f},
+	{"bench_v_vn_mixed.obj", OBJ_GENERATOR_FACE_V_VN, 0.0f, 0.25f, 0.5f, 0.2f},
+};
+
+typedef struct Bench_Result Bench_Result;
+struct Bench_Result {
+	bool success;
+	S64 bytes;
+	S64 lines;
+	S64 faces;
+	F64 min;
+	F64 median;
+	F64 p99;
+	S64 peak_memory; // The largest over all runs.
+};
+
+int compare_f64(const void *a, const void *b) {
+	F64 x = *(F64*)a, y = *(F64*)b;
+	return (x > y) - (x < y);
+}
+
+// Parses the file warmup + runs times. Times are in seconds.
+Bench_Result bench_file(char *file_name, U32 flags, S32 warmup, S32 runs, F64 *times) {
+	Bench_Result result = {};
+	result.success = true;
+	for (S32 run = -warmup; run < runs; run += 1) {
+		Arena arena;
+		arena_init(&arena, Megabytes(1), ARENA_FLAG_LARGE_PAGES);
+		reset_arena_peak_committed_memory();
+		S64 committed = get_arena_committed_memory();
+
+		F64 start = get_time_in_seconds();
+		Parse_Result parsed = parse(&arena, file_name, flags);
+		F64 seconds = get_time_in_seconds() - start;
+
+		if (run >= 0) {
+			times[run] = seconds;
+			result.peak_memory = Max(result.peak_memory, get_arena_peak_committed_memory() - committed);
+		}
+		result.success = result.success && parsed.success;
+		result.bytes = (S64)parsed.file.len;
+		result.lines = parsed.lines_parsed;
+		result.faces = 0;
+		if (parsed.scene) {
+			for (OBJ_Object *object = parsed.scene->objects_first; object; object = object->next) {
+				result.faces += object->indices_count / 3;
+			}
+		}
+		release_parse_result(&parsed);
+		arena_release(&arena);
+	}
+
+	qsort(times, runs, sizeof(F64), compare_f64);
+	result.min = times[0];
+	result.median = (runs % 2) ? times[runs / 2] : 0.5 * (times[runs / 2 - 1] + times[runs / 2]);
+	// Nearest rank.
+	S32 rank = (S32)((99 * (S64)runs + 99) / 100);
+	result.p99 = times[Max(rank, 1) - 1];
+	return result;
+}
+
+void print_json_string(FILE *out, char *string) {
+	fputc('"', out);
+	for (char *c = string; *c; c += 1) {
+		if (*c == '"' || *c == '\\') {
+			fputc('\\', out);
+		}
+		fputc(*c, out);
+	}
+	fputc('"', out);
+}
+
+int main(int argc, char **argv) {
+	Arena arena;
+	arena_init(&arena);
+
+	S32 runs = BENCH_DEFAULT_RUNS;
+	S32 warmup = BENCH_DEFAULT_WARMUP;
+	S64 generated_lines = BENCH_DEFAULT_LINES;
+	char *out_name = NULL;
+	char **files = (char**)arena_alloc(&arena, sizeof(char*) * argc);
+	S64 files_count = 0;
+	for (int i = 1; i < argc; i += 1) {
+		char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+		if (0 == strcmp(argv[i], "--runs") && value) {
+			runs = Max(atoi(value), 1);
+			i += 1;
+		} else if (0 == strcmp(argv[i], "--warmup") && value) {
+			warmup = Max(atoi(value), 0);
+			i += 1;
+		} else if (0 == strcmp(argv[i], "--lines") && value) {
+			generated_lines = Max(atoll(value), 0);
+			i += 1;
+		} else if (0 == strcmp(argv[i], "--out") && value) {
+			out_name = value;
+			i += 1;
+		} else if (argv[i][0] == '-') {
+			fprintf(stderr, "Usage: bench [--runs N] [--warmup N] [--lines N] [--out FILE] [file.obj ...]\n");
+			return 1;
+		} else {
+			files[files_count++] = argv[i];
+		}
+	}
+	if (files_count == 0) {
+		S64 res_count;
+		char **res_files = list_files(&arena, "../res", ".obj", &res_count);
+		files = res_files;
+		files_count = res_count;
+	}
+	if (generated_lines > 0) {
+		files = (char**)arena_realloc(&arena, files, sizeof(char*) * files_count, sizeof(char*) * (files_count + ArrayLen(bench_inputs)));
+		for (S32 i = 0; i < (S32)ArrayLen(bench_inputs); i += 1) {
+			Bench_Input *input = &bench_inputs[i];
+			OBJ_Generator_Options options = make_generator_options();
+			options.lines_count = generated_lines;
+			options.face_style = input->face_style;
+			options.tex_coords_ratio = input->tex_coords_ratio;
+			options.normals_ratio = input->normals_ratio;
+			options.exponent_ratio = input->exponent_ratio;
+			options.comment_ratio = input->comment_ratio;
+			if (!generate_obj_file(input->file_name, &options)) {
+				fprintf(stderr, "Error! Could not write %s\n", input->file_name);
+				return 1;
+			}
+			files[files_count++] = input->file_name;
+		}
+	}
+
+	FILE *out = out_name ? fopen(out_name, "w") : stdout;
+	if (!out) {
+		fprintf(stderr, "Error! Could not open %s\n", out_name);
+		return 1;
+	}
+	F64 *times = (F64*)arena_alloc(&arena, sizeof(F64) * runs);
+
+	fprintf(out, "{\n  \"runs\": %d,\n  \"warmup\": %d,\n  \"threads\": %d,\n  \"results\": [\n", runs, warmup, get_thread_pool()->worker_count + 1);
+	for (S64 i = 0; i < files_count; i += 1) {
+		for (S32 c = 0; c < (S32)ArrayLen(bench_configs); c += 1) {
+			Bench_Config *config = &bench_configs[c];
+			Bench_Result result = bench_file(files[i], config->flags, warmup, runs, times);
+
+			F64 mb_per_second = (F64)result.bytes / (1024.0 * 1024.0) / result.median;
+			fprintf(stderr, "%-32s %-22s %9.3f ms median, %9.3f ms min, %8.1f MB/s, %7.1f MiB peak%s\n",
+			        files[i], config->name, result.median * 1000.0, result.min * 1000.0, mb_per_second,
+			        (F64)result.peak_memory / (1024.0 * 1024.0), result.success ? "" : " (failed)");
+
+			bool last = (i == files_count - 1) && (c == (S32)ArrayLen(bench_configs) - 1);
+			fprintf(out, "    {\"file\": ");
+			print_json_string(out, files[i]);
+			fprintf(out, ", \"config\": \"%s\", \"flags\": %u, \"success\": %s, \"bytes\": %lld, \"lines\": %lld, \"faces\": %lld, ",
+			        config->name, config->flags, result.success ? "true" : "false", (long long)result.bytes,
+			        (long long)result.lines, (long long)result.faces);
+			fprintf(out, "\"min_ms\": %.4f, \"median_ms\": %.4f, \"p99_ms\": %.4f, \"mb_per_second\": %.2f, ",
+			        result.min * 1000.0, result.median * 1000.0, result.p99 * 1000.0, mb_per_second);
+			fprintf(out, "\"lines_per_second\": %.0f, \"faces_per_second\": %.0f, \"peak_memory_bytes\": %lld}%s\n",
+			        (F64)result.lines / result.median, (F64)result.faces / result.median, (long long)result.peak_memory,
+			        last ? "" : ",");
+		}
+	}
+	fprintf(out, "  ]\n}\n");
+
+	if (out != stdout) {
+		fclose(out);
+	}
+	return 0;
+}
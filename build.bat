@@ -13,4 +13,13 @@ cl.exe %compile_options% ..\main.cpp
 link.exe main.obj %link_options% user32.lib
 :: radlink.exe main.obj %link_options% user32.lib
 
+cl.exe %compile_options% ..\bvh_bench.cpp
+link.exe bvh_bench.obj %link_options:parse.exe=bvh_bench.exe% user32.lib
+
+cl.exe %compile_options% ..\bench.cpp
+link.exe bench.obj %link_options:parse.exe=bench.exe% user32.lib
+
+cl.exe %compile_options% ..\obj_gen.cpp
+link.exe obj_gen.obj %link_options:parse.exe=obj_gen.exe% user32.lib
+
 popd
@@ -0,0 +1,695 @@
+//
+// BVH
+//
+// A bounding volume hierarchy over the triangles of an object or a whole scene, for ray queries on the CPU.
+//
+// It is built top down with a binned surface area heuristic: the centroids of a node's triangles are sorted into
+// BVH_BINS_COUNT bins along each axis, and the cheapest bin boundary becomes the split. The top levels are split on the
+// calling thread until there are enough independent subtrees to keep the pool busy, which then builds them in parallel.
+// Finally the tree is flattened depth first into one array of 32 byte nodes, where the left child of an inner node
+// directly follows it, and the triangles are stored in leaf order.
+//
+
+#define BVH_BINS_COUNT 16
+#define BVH_MAX_LEAF_TRIANGLES 4
+#define BVH_TRAVERSAL_COST 1.0f // Relative to intersecting one triangle.
+#define BVH_STACK_SIZE 64
+#define BVH_SUBTREES_PER_THREAD 8
+
+typedef struct BVH_Node BVH_Node;
+struct BVH_Node {
+	Vec3F32 min;
+	U32 offset; // Leaves: the first triangle. Inner nodes: the right child.
+	Vec3F32 max;
+	U16 triangles_count; // 0 for inner nodes.
+	U16 axis; // Inner nodes are split along it, which decides which child a ray visits first.
+};
+
+// Stored with its edges for Möller-Trumbore.
+typedef struct BVH_Triangle BVH_Triangle;
+struct BVH_Triangle {
+	Vec3F32 v0;
+	Vec3F32 edge1; // v1 - v0
+	Vec3F32 edge2; // v2 - v0
+};
+
+// Where a triangle of the BVH comes from: the object and the triangle's position in the object's index buffer.
+typedef struct BVH_Triangle_Source BVH_Triangle_Source;
+struct BVH_Triangle_Source {
+	OBJ_Object *object;
+	U32 triangle;
+};
+
+typedef struct BVH BVH;
+struct BVH {
+	BVH_Node *nodes;
+	S64 nodes_count;
+	BVH_Triangle *triangles;
+	BVH_Triangle_Source *sources;
+	S64 triangles_count;
+};
+
+typedef struct BVH_Ray BVH_Ray;
+struct BVH_Ray {
+	Vec3F32 origin;
+	Vec3F32 direction; // Needn't be normalized, t is in units of it.
+	F32 t_max;
+};
+
+typedef struct BVH_Hit BVH_Hit;
+struct BVH_Hit {
+	F32 t;
+	F32 u; // Barycentric coordinates: the hit is v0 + u * edge1 + v * edge2.
+	F32 v;
+	U32 triangle; // Into BVH::triangles and BVH::sources.
+};
+
+// Works for every vertex layout and for PARSE_FLAG_SOA.
+Vec3F32 get_vertex_position(OBJ_Object *object, S64 index) {
+	if (!object->vertex_data) {
+		OBJ_Vertex_Streams *streams = &object->streams;
+		return {streams->x[index], streams->y[index], streams->z[index]};
+	}
+	switch (object->vertex_layout) {
+		case OBJ_VERTEX_LAYOUT_P4N3T3: {
+			Vec4F32 position = object->vertices[index].v;
+			return {position.x, position.y, position.z};
+		}
+		case OBJ_VERTEX_LAYOUT_Q16: {
+			return decode_position(object, &get_vertices<OBJ_Vertex_Q16>(object)[index]);
+		}
+		default: {
+			// The other layouts start with a Vec3F32 position.
+			return *(Vec3F32*)((U8*)object->vertex_data + obj_vertex_layout_size[object->vertex_layout] * index);
+		}
+	}
+}
+
+F32 get_half_area(Vec3F32 min, Vec3F32 max) {
+	Vec3F32 extent = max - min;
+	return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+void grow_box(Vec3F32 *min, Vec3F32 *max, Vec3F32 point_min, Vec3F32 point_max) {
+	min->x = Min(min->x, point_min.x); max->x = Max(max->x, point_max.x);
+	min->y = Min(min->y, point_min.y); max->y = Max(max->y, point_max.y);
+	min->z = Min(min->z, point_min.z); max->z = Max(max->z, point_max.z);
+}
+
+//
+// Building
+//
+
+typedef struct BVH_Build_Primitive BVH_Build_Primitive;
+struct BVH_Build_Primitive {
+	Vec3F32 min;
+	Vec3F32 max;
+	Vec3F32 centroid;
+	U32 triangle; // Into BVH_Build.triangles, which stay in input order.
+};
+
+typedef struct BVH_Build_Node BVH_Build_Node;
+struct BVH_Build_Node {
+	Vec3F32 min;
+	Vec3F32 max;
+	BVH_Build_Node *children[2]; // NULL for leaves.
+	U32 first;
+	U32 count;
+	U32 axis;
+};
+
+typedef struct BVH_Node_Pool BVH_Node_Pool;
+struct BVH_Node_Pool {
+	BVH_Build_Node *nodes;
+	S64 count;
+	S64 capacity;
+};
+
+// A node whose triangles are built into a tree by one task.
+typedef struct BVH_Subtree BVH_Subtree;
+struct BVH_Subtree {
+	BVH_Build_Node *root;
+	U32 begin;
+	U32 end;
+	BVH_Node_Pool pool;
+};
+
+// The top nodes and the subtrees each grow in an arena of their own, so they never move while nodes point at them.
+typedef struct BVH_Build BVH_Build;
+struct BVH_Build {
+	Arena *temp;
+	Arena *subtree_nodes;
+	Arena top_nodes_arena;
+	Arena subtrees_arena;
+	BVH_Build_Primitive *primitives;
+	BVH_Triangle *triangles;
+	BVH_Triangle_Source *sources;
+	S64 triangles_count;
+
+	BVH_Node_Pool top_nodes;
+	BVH_Subtree *subtrees;
+	S64 subtrees_count;
+	S64 subtrees_capacity;
+	S64 subtree_size; // Nodes with at most this many triangles become subtrees.
+};
+
+typedef struct BVH_Split BVH_Split;
+struct BVH_Split {
+	S32 axis; // -1 if no bin boundary separates the centroids.
+	S32 bin;  // Bins up to and including it go left.
+	F32 cost;
+	F32 centroid_min; // Maps centroids on the axis to bins.
+	F32 bin_scale;
+};
+
+BVH_Build_Node *make_bvh_build_node(BVH_Node_Pool *pool) {
+	Assert(pool->count < pool->capacity);
+	BVH_Build_Node *node = &pool->nodes[pool->count++];
+	MemoryZero(node, sizeof(*node));
+	return node;
+}
+
+S32 get_bvh_bin(BVH_Split *split, Vec3F32 centroid) {
+	S32 bin = (S32)((centroid.v[split->axis] - split->centroid_min) * split->bin_scale);
+	return Clamp(bin, 0, BVH_BINS_COUNT - 1);
+}
+
+// Sets the bounds of the node from its triangles and finds the cheapest split of them.
+BVH_Split find_bvh_split(BVH_Build *build, BVH_Build_Node *node, U32 begin, U32 end) {
+	Vec3F32 centroid_min = build->primitives[begin].centroid;
+	Vec3F32 centroid_max = centroid_min;
+	node->min = build->primitives[begin].min;
+	node->max = build->primitives[begin].max;
+	for (U32 i = begin; i < end; i += 1) {
+		BVH_Build_Primitive *primitive = &build->primitives[i];
+		grow_box(&node->min, &node->max, primitive->min, primitive->max);
+		grow_box(&centroid_min, &centroid_max, primitive->centroid, primitive->centroid);
+	}
+
+	BVH_Split best = {-1, 0, F32_MAX, 0.0f, 0.0f};
+	for (S32 axis = 0; axis < 3; axis += 1) {
+		F32 extent = centroid_max.v[axis] - centroid_min.v[axis];
+		if (extent <= 0.0f) {
+			continue;
+		}
+		BVH_Split split = {axis, 0, F32_MAX, centroid_min.v[axis], (F32)BVH_BINS_COUNT * 0.9999f / extent};
+
+		Vec3F32 bin_min[BVH_BINS_COUNT], bin_max[BVH_BINS_COUNT];
+		U32 bin_count[BVH_BINS_COUNT] = {};
+		for (S32 i = 0; i < BVH_BINS_COUNT; i += 1) {
+			bin_min[i] = {F32_MAX, F32_MAX, F32_MAX};
+			bin_max[i] = {-F32_MAX, -F32_MAX, -F32_MAX};
+		}
+		for (U32 i = begin; i < end; i += 1) {
+			BVH_Build_Primitive *primitive = &build->primitives[i];
+			S32 bin = get_bvh_bin(&split, primitive->centroid);
+			bin_count[bin] += 1;
+			grow_box(&bin_min[bin], &bin_max[bin], primitive->min, primitive->max);
+		}
+
+		// Sweep from the right for the cost of everything after each boundary, then from the left.
+		F32 right_cost[BVH_BINS_COUNT];
+		Vec3F32 min = {F32_MAX, F32_MAX, F32_MAX}, max = {-F32_MAX, -F32_MAX, -F32_MAX};
+		U32 count = 0;
+		for (S32 i = BVH_BINS_COUNT - 1; i > 0; i -= 1) {
+			grow_box(&min, &max, bin_min[i], bin_max[i]);
+			count += bin_count[i];
+			right_cost[i - 1] = count ? get_half_area(min, max) * (F32)count : F32_MAX;
+		}
+		min = {F32_MAX, F32_MAX, F32_MAX};
+		max = {-F32_MAX, -F32_MAX, -F32_MAX};
+		count = 0;
+		for (S32 i = 0; i < BVH_BINS_COUNT - 1; i += 1) {
+			grow_box(&min, &max, bin_min[i], bin_max[i]);
+			count += bin_count[i];
+			if (count == 0 || count == end - begin) {
+				continue;
+			}
+			F32 cost = get_half_area(min, max) * (F32)count + right_cost[i];
+			if (cost < best.cost) {
+				best = split;
+				best.bin = i;
+				best.cost = cost;
+			}
+		}
+	}
+	return best;
+}
+
+// Moves the triangles going left to the front and returns where the right ones start.
+U32 partition_bvh_node(BVH_Build *build, BVH_Split *split, U32 begin, U32 end) {
+	U32 left = begin;
+	U32 right = end;
+	while (left < right) {
+		if (get_bvh_bin(split, build->primitives[left].centroid) <= split->bin) {
+			left += 1;
+		} else {
+			right -= 1;
+			BVH_Build_Primitive swap = build->primitives[left];
+			build->primitives[left] = build->primitives[right];
+			build->primitives[right] = swap;
+		}
+	}
+	return left;
+}
+
+// Decides between a leaf and a split. Returns where the right child starts, or end for a leaf.
+U32 split_bvh_node(BVH_Build *build, BVH_Build_Node *node, U32 begin, U32 end) {
+	U32 count = end - begin;
+	node->first = begin;
+	node->count = count;
+	BVH_Split split = find_bvh_split(build, node, begin, end);
+
+	F32 area = get_half_area(node->min, node->max);
+	F32 split_cost = (split.axis >= 0 && area > 0.0f) ? BVH_TRAVERSAL_COST + split.cost / area : F32_MAX;
+	if (count <= BVH_MAX_LEAF_TRIANGLES && (F32)count <= split_cost) {
+		return end;
+	}
+	U32 middle;
+	if (split.axis >= 0) {
+		node->axis = (U32)split.axis;
+		middle = partition_bvh_node(build, &split, begin, end);
+	} else {
+		// All centroids coincide, no boundary separates them. Too many triangles for a leaf, so halve them.
+		middle = begin + count / 2;
+	}
+	node->count = 0;
+	return middle;
+}
+
+void build_bvh_node(BVH_Build *build, BVH_Node_Pool *pool, BVH_Build_Node *node, U32 begin, U32 end) {
+	U32 middle = split_bvh_node(build, node, begin, end);
+	if (middle == end) {
+		return;
+	}
+	node->children[0] = make_bvh_build_node(pool);
+	node->children[1] = make_bvh_build_node(pool);
+	build_bvh_node(build, pool, node->children[0], begin, middle);
+	build_bvh_node(build, pool, node->children[1], middle, end);
+}
+
+void build_bvh_subtree(void *data, S64 subtree_index) {
+	BVH_Build *build = (BVH_Build*)data;
+	BVH_Subtree *subtree = &build->subtrees[subtree_index];
+	build_bvh_node(build, &subtree->pool, subtree->root, subtree->begin, subtree->end);
+}
+
+BVH_Build_Node *make_bvh_top_node(BVH_Build *build) {
+	if (build->top_nodes.count == build->top_nodes.capacity) {
+		build->top_nodes.nodes = (BVH_Build_Node*)grow_array(&build->top_nodes_arena, build->top_nodes.nodes, sizeof(BVH_Build_Node), &build->top_nodes.capacity);
+	}
+	return make_bvh_build_node(&build->top_nodes);
+}
+
+// Splits on the calling thread until the nodes are small enough to be subtrees. Allocates their nodes, since a tree
+// over n triangles has at most 2n - 1 nodes.
+void split_bvh_top(BVH_Build *build, BVH_Build_Node *node, U32 begin, U32 end) {
+	U32 middle = end;
+	if (end - begin > build->subtree_size) {
+		middle = split_bvh_node(build, node, begin, end);
+	}
+	if (middle == end) {
+		if (build->subtrees_count == build->subtrees_capacity) {
+			build->subtrees = (BVH_Subtree*)grow_array(&build->subtrees_arena, build->subtrees, sizeof(BVH_Subtree), &build->subtrees_capacity);
+		}
+		BVH_Subtree *subtree = &build->subtrees[build->subtrees_count++];
+		subtree->root = node;
+		subtree->begin = begin;
+		subtree->end = end;
+		subtree->pool.count = 0;
+		subtree->pool.capacity = 2 * (S64)(end - begin) - 1;
+		subtree->pool.nodes = (BVH_Build_Node*)arena_alloc(build->subtree_nodes, sizeof(BVH_Build_Node) * subtree->pool.capacity);
+		return;
+	}
+	node->children[0] = make_bvh_top_node(build);
+	node->children[1] = make_bvh_top_node(build);
+	split_bvh_top(build, node->children[0], begin, middle);
+	split_bvh_top(build, node->children[1], middle, end);
+}
+
+U32 flatten_bvh_node(BVH *bvh, BVH_Build_Node *node) {
+	U32 index = (U32)bvh->nodes_count++;
+	BVH_Node *flat = &bvh->nodes[index];
+	flat->min = node->min;
+	flat->max = node->max;
+	if (!node->children[0]) {
+		flat->offset = node->first;
+		flat->triangles_count = (U16)node->count;
+		flat->axis = 0;
+		return index;
+	}
+	flat->triangles_count = 0;
+	flat->axis = (U16)node->axis;
+	flatten_bvh_node(bvh, node->children[0]);
+	U32 right = flatten_bvh_node(bvh, node->children[1]);
+	bvh->nodes[index].offset = right;
+	return index;
+}
+
+void add_bvh_triangle(BVH_Build *build, S64 index, OBJ_Object *object, U32 triangle, Vec3F32 a, Vec3F32 b, Vec3F32 c) {
+	BVH_Build_Primitive *primitive = &build->primitives[index];
+	primitive->min = primitive->max = a;
+	grow_box(&primitive->min, &primitive->max, b, b);
+	grow_box(&primitive->min, &primitive->max, c, c);
+	primitive->centroid = (a + b + c) * (1.0f / 3.0f);
+	build->triangles[index] = {a, b - a, c - a};
+	build->sources[index] = {object, triangle};
+	primitive->triangle = (U32)index;
+}
+
+// Builds the tree over the prepared triangles and stores it, and the triangles in leaf order, in the BVH.
+void build_bvh_nodes(Arena *arena, BVH_Build *build, BVH *bvh, Thread_Pool *pool) {
+	BVH_Build_Node *root = make_bvh_top_node(build);
+	split_bvh_top(build, root, 0, (U32)build->triangles_count);
+	thread_pool_run(pool, build->subtrees_count, build_bvh_subtree, build);
+
+	S64 nodes_count = build->top_nodes.count;
+	for (S64 i = 0; i < build->subtrees_count; i += 1) {
+		nodes_count += build->subtrees[i].pool.count;
+	}
+	bvh->nodes = (BVH_Node*)arena_alloc(arena, sizeof(BVH_Node) * nodes_count, 64);
+	flatten_bvh_node(bvh, root);
+	Assert(bvh->nodes_count == nodes_count);
+
+	bvh->triangles_count = build->triangles_count;
+	bvh->triangles = (BVH_Triangle*)arena_alloc(arena, sizeof(BVH_Triangle) * bvh->triangles_count);
+	bvh->sources = (BVH_Triangle_Source*)arena_alloc(arena, sizeof(BVH_Triangle_Source) * bvh->triangles_count);
+	for (S64 i = 0; i < bvh->triangles_count; i += 1) {
+		bvh->triangles[i] = build->triangles[build->primitives[i].triangle];
+		bvh->sources[i] = build->sources[build->primitives[i].triangle];
+	}
+}
+
+BVH *build_bvh(Arena *arena, OBJ_Object **objects, S64 objects_count, Thread_Pool *pool) {
+	Arena temp, subtree_nodes;
+	arena_init(&temp);
+	arena_init(&subtree_nodes);
+
+	BVH_Build build = {};
+	build.temp = &temp;
+	build.subtree_nodes = &subtree_nodes;
+	arena_init(&build.top_nodes_arena);
+	arena_init(&build.subtrees_arena);
+	for (S64 i = 0; i < objects_count; i += 1) {
+		build.triangles_count += objects[i]->indices_count / 3;
+	}
+	build.primitives = (BVH_Build_Primitive*)arena_alloc(&temp, sizeof(BVH_Build_Primitive) * build.triangles_count);
+	build.triangles = (BVH_Triangle*)arena_alloc(&temp, sizeof(BVH_Triangle) * build.triangles_count);
+	build.sources = (BVH_Triangle_Source*)arena_alloc(&temp, sizeof(BVH_Triangle_Source) * build.triangles_count);
+
+	S64 index = 0;
+	for (S64 i = 0; i < objects_count; i += 1) {
+		OBJ_Object *object = objects[i];
+		OBJ_Submesh whole = {0, object->indices_count, 0, object->vertices_count};
+		OBJ_Submesh *submeshes = object->submeshes ? object->submeshes : &whole;
+		S64 submeshes_count = object->submeshes ? object->submeshes_count : 1;
+		for (S64 s = 0; s < submeshes_count; s += 1) {
+			OBJ_Submesh *submesh = &submeshes[s];
+			for (S64 j = submesh->first_index; j + 2 < submesh->first_index + submesh->indices_count; j += 3) {
+				Vec3F32 a = get_vertex_position(object, get_object_index(object, j + 0, submesh->first_vertex));
+				Vec3F32 b = get_vertex_position(object, get_object_index(object, j + 1, submesh->first_vertex));
+				Vec3F32 c = get_vertex_position(object, get_object_index(object, j + 2, submesh->first_vertex));
+				add_bvh_triangle(&build, index++, object, (U32)(j / 3), a, b, c);
+			}
+		}
+	}
+	build.triangles_count = index;
+
+	BVH *bvh = (BVH*)arena_alloc(arena, sizeof(BVH));
+	MemoryZero(bvh, sizeof(*bvh));
+	if (build.triangles_count > 0) {
+		S64 subtrees_target = pool ? (S64)(pool->worker_count + 1) * BVH_SUBTREES_PER_THREAD : 1;
+		build.subtree_size = Max(build.triangles_count / subtrees_target, (S64)BVH_MAX_LEAF_TRIANGLES);
+		build_bvh_nodes(arena, &build, bvh, pool);
+	}
+
+	arena_release(&build.subtrees_arena);
+	arena_release(&build.top_nodes_arena);
+	arena_release(&subtree_nodes);
+	arena_release(&temp);
+	return bvh;
+}
+BVH *build_bvh(Arena *arena, OBJ_Object *object, Thread_Pool *pool = NULL) {
+	return build_bvh(arena, &object, 1, pool);
+}
+
+BVH *build_bvh(Arena *arena, OBJ_Scene *scene, Thread_Pool *pool = NULL) {
+	Arena *scratch = begin_scratch();
+	S64 objects_count = 0;
+	for (OBJ_Object *object = scene->objects_first; object; object = object->next) {
+		objects_count += 1;
+	}
+	OBJ_Object **objects = (OBJ_Object**)arena_alloc(scratch, sizeof(OBJ_Object*) * objects_count);
+	S64 i = 0;
+	for (OBJ_Object *object = scene->objects_first; object; object = object->next) {
+		objects[i++] = object;
+	}
+	BVH *bvh = build_bvh(arena, objects, objects_count, pool);
+	end_scratch(scratch);
+	return bvh;
+}
+
+//
+// Ray queries
+//
+
+// Keeps 1 / direction finite, which keeps NaNs out of the slab tests.
+F32 get_safe_inverse(F32 direction) {
+	F32 epsilon = 1e-20f;
+	return 1.0f / ((Abs(direction) < epsilon) ? ((direction < 0.0f) ? -epsilon : epsilon) : direction);
+}
+
+bool intersect_triangle(BVH_Triangle *triangle, Vec3F32 origin, Vec3F32 direction, F32 t_max, BVH_Hit *hit) {
+	Vec3F32 p = cross_3f32(direction, triangle->edge2);
+	F32 determinant = dot_3f32(triangle->edge1, p);
+	if (Abs(determinant) < 1e-12f) {
+		return false; // Parallel to the triangle.
+	}
+	F32 inverse_determinant = 1.0f / determinant;
+	Vec3F32 to_origin = origin - triangle->v0;
+	F32 u = dot_3f32(to_origin, p) * inverse_determinant;
+	if (u < 0.0f || u > 1.0f) {
+		return false;
+	}
+	Vec3F32 q = cross_3f32(to_origin, triangle->edge1);
+	F32 v = dot_3f32(direction, q) * inverse_determinant;
+	if (v < 0.0f || u + v > 1.0f) {
+		return false;
+	}
+	F32 t = dot_3f32(triangle->edge2, q) * inverse_determinant;
+	if (t <= 0.0f || t >= t_max) {
+		return false;
+	}
+	hit->t = t;
+	hit->u = u;
+	hit->v = v;
+	return true;
+}
+
+#if defined(SIMD_AVX512) || defined(SIMD_AVX2) || defined(SIMD_SSE2)
+// Tests the three slabs at once. Lane 3 holds the node's offset, so it's left out of the reductions.
+bool intersect_node(BVH_Node *node, __m128 origin, __m128 inverse, F32 t_max, F32 *t_near) {
+	__m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node->min.v), origin), inverse);
+	__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node->max.v), origin), inverse);
+	__m128 near = _mm_min_ps(t0, t1);
+	__m128 far = _mm_max_ps(t0, t1);
+	__m128 near_yzx = _mm_shuffle_ps(near, near, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 near_zxy = _mm_shuffle_ps(near, near, _MM_SHUFFLE(3, 1, 0, 2));
+	__m128 far_yzx = _mm_shuffle_ps(far, far, _MM_SHUFFLE(3, 0, 2, 1));
+	__m128 far_zxy = _mm_shuffle_ps(far, far, _MM_SHUFFLE(3, 1, 0, 2));
+	F32 entry = _mm_cvtss_f32(_mm_max_ss(_mm_max_ss(near, near_yzx), near_zxy));
+	F32 exit = _mm_cvtss_f32(_mm_min_ss(_mm_min_ss(far, far_yzx), far_zxy));
+	entry = Max(entry, 0.0f);
+	exit = Min(exit, t_max);
+	*t_near = entry;
+	return entry <= exit;
+}
+#else
+bool intersect_node(BVH_Node *node, Vec3F32 origin, Vec3F32 inverse, F32 t_max, F32 *t_near) {
+	F32 entry = 0.0f;
+	F32 exit = t_max;
+	for (S32 axis = 0; axis < 3; axis += 1) {
+		F32 t0 = (node->min.v[axis] - origin.v[axis]) * inverse.v[axis];
+		F32 t1 = (node->max.v[axis] - origin.v[axis]) * inverse.v[axis];
+		entry = Max(entry, Min(t0, t1));
+		exit = Min(exit, Max(t0, t1));
+	}
+	*t_near = entry;
+	return entry <= exit;
+}
+#endif
+
+// Finds the closest hit closer than ray->t_max.
+bool intersect_ray(BVH *bvh, BVH_Ray *ray, BVH_Hit *hit) {
+	if (bvh->nodes_count == 0) {
+		return false;
+	}
+	Vec3F32 inverse = {get_safe_inverse(ray->direction.x), get_safe_inverse(ray->direction.y), get_safe_inverse(ray->direction.z)};
+#if defined(SIMD_AVX512) || defined(SIMD_AVX2) || defined(SIMD_SSE2)
+	__m128 origin_simd = _mm_setr_ps(ray->origin.x, ray->origin.y, ray->origin.z, 0.0f);
+	__m128 inverse_simd = _mm_setr_ps(inverse.x, inverse.y, inverse.z, 0.0f);
+#else
+	Vec3F32 origin_simd = ray->origin;
+	Vec3F32 inverse_simd = inverse;
+#endif
+
+	F32 t_max = ray->t_max;
+	bool found = false;
+	U32 stack[BVH_STACK_SIZE];
+	S32 stack_count = 0;
+	U32 node_index = 0;
+	F32 t_near;
+	if (!intersect_node(&bvh->nodes[0], origin_simd, inverse_simd, t_max, &t_near)) {
+		return false;
+	}
+	for (;;) {
+		BVH_Node *node = &bvh->nodes[node_index];
+		if (node->triangles_count) {
+			for (U32 i = node->offset; i < node->offset + node->triangles_count; i += 1) {
+				if (intersect_triangle(&bvh->triangles[i], ray->origin, ray->direction, t_max, hit)) {
+					hit->triangle = i;
+					t_max = hit->t;
+					found = true;
+				}
+			}
+		} else {
+			// Visit the nearer child first, and skip children the ray misses.
+			U32 children[2] = {node_index + 1, node->offset};
+			F32 t_children[2];
+			bool hits[2];
+			for (S32 i = 0; i < 2; i += 1) {
+				hits[i] = intersect_node(&bvh->nodes[children[i]], origin_simd, inverse_simd, t_max, &t_children[i]);
+			}
+			if (hits[0] && hits[1]) {
+				S32 first = (t_children[1] < t_children[0]) ? 1 : 0;
+				Assert(stack_count < BVH_STACK_SIZE);
+				stack[stack_count++] = children[1 - first];
+				node_index = children[first];
+				continue;
+			}
+			if (hits[0] || hits[1]) {
+				node_index = hits[0] ? children[0] : children[1];
+				continue;
+			}
+		}
+		if (stack_count == 0) {
+			break;
+		}
+		node_index = stack[--stack_count];
+	}
+	return found;
+}
+
+// Traces four rays together, which pays off when they are coherent, e.g. neighbouring pixels. Returns a bit per ray
+// that hit, and fills its hit.
+U32 intersect_ray_packet(BVH *bvh, BVH_Ray *rays, BVH_Hit *hits) {
+#if defined(SIMD_AVX512) || defined(SIMD_AVX2) || defined(SIMD_SSE2)
+	if (bvh->nodes_count == 0) {
+		return 0;
+	}
+	__m128 origin[3], direction[3], inverse[3];
+	for (S32 axis = 0; axis < 3; axis += 1) {
+		origin[axis] = _mm_setr_ps(rays[0].origin.v[axis], rays[1].origin.v[axis], rays[2].origin.v[axis], rays[3].origin.v[axis]);
+		direction[axis] = _mm_setr_ps(rays[0].direction.v[axis], rays[1].direction.v[axis], rays[2].direction.v[axis], rays[3].direction.v[axis]);
+		inverse[axis] = _mm_setr_ps(get_safe_inverse(rays[0].direction.v[axis]), get_safe_inverse(rays[1].direction.v[axis]),
+		                            get_safe_inverse(rays[2].direction.v[axis]), get_safe_inverse(rays[3].direction.v[axis]));
+	}
+	__m128 t_max = _mm_setr_ps(rays[0].t_max, rays[1].t_max, rays[2].t_max, rays[3].t_max);
+	__m128 hit_u = _mm_setzero_ps();
+	__m128 hit_v = _mm_setzero_ps();
+	__m128i hit_triangle = _mm_set1_epi32(-1);
+	__m128 zero = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps(1.0f);
+
+	U32 stack[BVH_STACK_SIZE];
+	S32 stack_count = 0;
+	stack[stack_count++] = 0;
+	while (stack_count > 0) {
+		BVH_Node *node = &bvh->nodes[stack[--stack_count]];
+
+		__m128 entry = zero;
+		__m128 exit = t_max;
+		for (S32 axis = 0; axis < 3; axis += 1) {
+			__m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node->min.v[axis]), origin[axis]), inverse[axis]);
+			__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node->max.v[axis]), origin[axis]), inverse[axis]);
+			entry = _mm_max_ps(entry, _mm_min_ps(t0, t1));
+			exit = _mm_min_ps(exit, _mm_max_ps(t0, t1));
+		}
+		if (!_mm_movemask_ps(_mm_cmple_ps(entry, exit))) {
+			continue;
+		}
+
+		if (!node->triangles_count) {
+			// Near child on top. The packet is assumed to be coherent, so the first ray decides the order.
+			U32 left = (U32)(node - bvh->nodes) + 1;
+			U32 right = node->offset;
+			bool right_first = rays[0].direction.v[node->axis] < 0.0f;
+			Assert(stack_count + 2 <= BVH_STACK_SIZE);
+			stack[stack_count++] = right_first ? left : right;
+			stack[stack_count++] = right_first ? right : left;
+			continue;
+		}
+
+		for (U32 i = node->offset; i < node->offset + node->triangles_count; i += 1) {
+			BVH_Triangle *triangle = &bvh->triangles[i];
+			__m128 e1x = _mm_set1_ps(triangle->edge1.x), e1y = _mm_set1_ps(triangle->edge1.y), e1z = _mm_set1_ps(triangle->edge1.z);
+			__m128 e2x = _mm_set1_ps(triangle->edge2.x), e2y = _mm_set1_ps(triangle->edge2.y), e2z = _mm_set1_ps(triangle->edge2.z);
+
+			__m128 px = _mm_sub_ps(_mm_mul_ps(direction[1], e2z), _mm_mul_ps(direction[2], e2y));
+			__m128 py = _mm_sub_ps(_mm_mul_ps(direction[2], e2x), _mm_mul_ps(direction[0], e2z));
+			__m128 pz = _mm_sub_ps(_mm_mul_ps(direction[0], e2y), _mm_mul_ps(direction[1], e2x));
+			__m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+			__m128 absolute = _mm_andnot_ps(_mm_set1_ps(-0.0f), determinant);
+			__m128 valid = _mm_cmpge_ps(absolute, _mm_set1_ps(1e-12f));
+			__m128 inverse_determinant = _mm_div_ps(one, determinant);
+
+			__m128 tx = _mm_sub_ps(origin[0], _mm_set1_ps(triangle->v0.x));
+			__m128 ty = _mm_sub_ps(origin[1], _mm_set1_ps(triangle->v0.y));
+			__m128 tz = _mm_sub_ps(origin[2], _mm_set1_ps(triangle->v0.z));
+			__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), inverse_determinant);
+
+			__m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+			__m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+			__m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+			__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(direction[0], qx), _mm_mul_ps(direction[1], qy)), _mm_mul_ps(direction[2], qz)), inverse_determinant);
+			__m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverse_determinant);
+
+			valid = _mm_and_ps(valid, _mm_cmpge_ps(u, zero));
+			valid = _mm_and_ps(valid, _mm_cmple_ps(u, one));
+			valid = _mm_and_ps(valid, _mm_cmpge_ps(v, zero));
+			valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(u, v), one));
+			valid = _mm_and_ps(valid, _mm_cmpgt_ps(t, zero));
+			valid = _mm_and_ps(valid, _mm_cmplt_ps(t, t_max));
+			if (!_mm_movemask_ps(valid)) {
+				continue;
+			}
+			t_max = _mm_or_ps(_mm_and_ps(valid, t), _mm_andnot_ps(valid, t_max));
+			hit_u = _mm_or_ps(_mm_and_ps(valid, u), _mm_andnot_ps(valid, hit_u));
+			hit_v = _mm_or_ps(_mm_and_ps(valid, v), _mm_andnot_ps(valid, hit_v));
+			__m128i valid_i = _mm_castps_si128(valid);
+			hit_triangle = _mm_or_si128(_mm_and_si128(valid_i, _mm_set1_epi32((S32)i)), _mm_andnot_si128(valid_i, hit_triangle));
+		}
+	}
+
+	F32 t_out[4], u_out[4], v_out[4];
+	S32 triangle_out[4];
+	_mm_storeu_ps(t_out, t_max);
+	_mm_storeu_ps(u_out, hit_u);
+	_mm_storeu_ps(v_out, hit_v);
+	_mm_storeu_si128((__m128i*)triangle_out, hit_triangle);
+	U32 mask = 0;
+	for (S32 i = 0; i < 4; i += 1) {
+		if (triangle_out[i] >= 0) {
+			hits[i] = {t_out[i], u_out[i], v_out[i], (U32)triangle_out[i]};
+			mask |= 1u << i;
+		}
+	}
+	return mask;
+#else
+	U32 mask = 0;
+	for (S32 i = 0; i < 4; i += 1) {
+		mask |= (U32)intersect_ray(bvh, &rays[i], &hits[i]) << i;
+	}
+	return mask;
+#endif
+}
@@ -0,0 +1,195 @@
+#include "basic.cpp"
+#include "basic_math.cpp"
+#include "parser.cpp"
+#include "bvh.cpp"
+
+// Measures building a BVH over an obj file and tracing rays against it.
+//
+//   bvh_bench [file.obj]    Defaults to ../res/car.obj, run from inside bin/ like parse.
+//
+// Primary rays come from a camera outside the scene, in 2x2 pixel packets. Random rays start anywhere inside the
+// scene's bounding sphere and go anywhere, which is the worst case for packets.
+
+#define BENCH_IMAGE_SIZE 1024
+#define BENCH_BUILD_RUNS 5
+#define BENCH_RAYS_PER_TASK 4096
+#define BENCH_VERIFIED_RAYS 256
+
+typedef struct Ray_Batch Ray_Batch;
+struct Ray_Batch {
+	BVH *bvh;
+	BVH_Ray *rays;
+	BVH_Hit *hits;
+	U32 *hit_masks; // One bit per ray.
+	S64 rays_count;
+	bool packets;
+};
+
+U32 random_u32(U64 *state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return (U32)(*state >> 32);
+}
+
+F32 random_f32(U64 *state) {
+	return (F32)(random_u32(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+Vec3F32 random_direction(U64 *state) {
+	for (;;) {
+		Vec3F32 v = {random_f32(state) * 2.0f - 1.0f, random_f32(state) * 2.0f - 1.0f, random_f32(state) * 2.0f - 1.0f};
+		F32 length = len_3f32(v);
+		if (length > 0.01f && length <= 1.0f) {
+			return v * (1.0f / length);
+		}
+	}
+}
+
+// Pixels are ordered in 2x2 blocks, so that every four consecutive rays make a coherent packet.
+void make_camera_rays(BVH_Ray *rays, OBJ_Bounds *bounds) {
+	Vec3F32 eye = bounds->center + normalize_3f32({0.6f, 0.4f, 1.0f}) * (bounds->radius * 2.5f);
+	Vec3F32 forward = normalize_3f32(bounds->center - eye);
+	Vec3F32 right = normalize_3f32(cross_3f32(forward, {0.0f, 1.0f, 0.0f}));
+	Vec3F32 up = cross_3f32(right, forward);
+	F32 half_width = 0.45f; // About a 50 degree field of view.
+
+	S64 i = 0;
+	for (S32 y = 0; y < BENCH_IMAGE_SIZE; y += 2) {
+		for (S32 x = 0; x < BENCH_IMAGE_SIZE; x += 2) {
+			for (S32 j = 0; j < 4; j += 1) {
+				F32 sx = ((F32)(x + (j & 1)) + 0.5f) / BENCH_IMAGE_SIZE * 2.0f - 1.0f;
+				F32 sy = ((F32)(y + (j >> 1)) + 0.5f) / BENCH_IMAGE_SIZE * 2.0f - 1.0f;
+				rays[i++] = {eye, forward + right * (sx * half_width) + up * (-sy * half_width), F32_MAX};
+			}
+		}
+	}
+}
+
+void make_random_rays(BVH_Ray *rays, S64 rays_count, OBJ_Bounds *bounds) {
+	U64 state = 0x9e3779b97f4a7c15ULL;
+	for (S64 i = 0; i < rays_count; i += 1) {
+		Vec3F32 origin = bounds->center + random_direction(&state) * (bounds->radius * random_f32(&state));
+		rays[i] = {origin, random_direction(&state), F32_MAX};
+	}
+}
+
+void trace_ray_batch(void *data, S64 task_index) {
+	Ray_Batch *batch = (Ray_Batch*)data;
+	S64 begin = task_index * BENCH_RAYS_PER_TASK;
+	S64 end = Min(begin + BENCH_RAYS_PER_TASK, batch->rays_count);
+	for (S64 i = begin; i < end; i += 4) {
+		U32 mask = 0;
+		if (batch->packets) {
+			mask = intersect_ray_packet(batch->bvh, &batch->rays[i], &batch->hits[i]);
+		} else {
+			for (S64 j = 0; j < 4; j += 1) {
+				mask |= (U32)intersect_ray(batch->bvh, &batch->rays[i + j], &batch->hits[i + j]) << j;
+			}
+		}
+		batch->hit_masks[i / 4] = mask;
+	}
+}
+
+// Returns the rays traced per second.
+F64 trace_rays(Ray_Batch *batch, Thread_Pool *pool, S64 *hits_count) {
+	S64 tasks_count = (batch->rays_count + BENCH_RAYS_PER_TASK - 1) / BENCH_RAYS_PER_TASK;
+	F64 start = get_time_in_seconds();
+	thread_pool_run(pool, tasks_count, trace_ray_batch, batch);
+	F64 seconds = get_time_in_seconds() - start;
+
+	*hits_count = 0;
+	for (S64 i = 0; i < batch->rays_count / 4; i += 1) {
+		*hits_count += count_set_bits(batch->hit_masks[i]);
+	}
+	return (F64)batch->rays_count / seconds;
+}
+
+// Compares single rays against packets and a few rays against testing every triangle. Distances also get some slack
+// relative to the scene size, since the scalar and SIMD paths round differently for hits very close to the origin.
+// Rays grazing a shared edge can still disagree, the triangle test is not watertight.
+S64 count_mismatches(BVH *bvh, BVH_Ray *rays, S64 rays_count, F32 tolerance) {
+	S64 mismatches = 0;
+	for (S64 i = 0; i < rays_count; i += 4) {
+		BVH_Hit single[4], packet[4];
+		U32 single_mask = 0;
+		for (S64 j = 0; j < 4; j += 1) {
+			single_mask |= (U32)intersect_ray(bvh, &rays[i + j], &single[j]) << j;
+		}
+		U32 packet_mask = intersect_ray_packet(bvh, &rays[i], packet);
+		for (S64 j = 0; j < 4; j += 1) {
+			bool single_hit = single_mask & (1u << j);
+			if (single_hit != (bool)(packet_mask & (1u << j)) || (single_hit && Abs(single[j].t - packet[j].t) > tolerance + 1e-4f * single[j].t)) {
+				mismatches += 1;
+			}
+		}
+	}
+	for (S64 i = 0; i < BENCH_VERIFIED_RAYS; i += 1) {
+		BVH_Ray *ray = &rays[i * (rays_count / BENCH_VERIFIED_RAYS)];
+		BVH_Hit hit, closest = {F32_MAX, 0.0f, 0.0f, 0};
+		for (S64 t = 0; t < bvh->triangles_count; t += 1) {
+			if (intersect_triangle(&bvh->triangles[t], ray->origin, ray->direction, closest.t, &hit)) {
+				closest = hit;
+			}
+		}
+		bool found = intersect_ray(bvh, ray, &hit);
+		if (found != (closest.t < F32_MAX) || (found && Abs(hit.t - closest.t) > tolerance + 1e-4f * closest.t)) {
+			mismatches += 1;
+		}
+	}
+	return mismatches;
+}
+
+int main(int argc, char **argv) {
+	Arena perm;
+	arena_init(&perm, Megabytes(1), ARENA_FLAG_LARGE_PAGES);
+	char *file_name = (argc > 1) ? argv[1] : (char*)"../res/car.obj";
+	Thread_Pool *pool = get_thread_pool();
+
+	Parse_Result parsed = parse(&perm, file_name, PARSE_FLAG_MULTITHREADED);
+	if (!parsed.success) {
+		printf("Error! Could not parse %s\n", file_name);
+		return 1;
+	}
+
+	// Keep the fastest of a few builds, each into the same memory.
+	BVH *bvh = NULL;
+	F64 build_serial = F32_MAX, build_parallel = F32_MAX;
+	size_t perm_used = perm.used;
+	for (S32 run = 0; run < BENCH_BUILD_RUNS; run += 1) {
+		perm.used = perm_used;
+		F64 start = get_time_in_seconds();
+		bvh = build_bvh(&perm, parsed.scene, NULL);
+		build_serial = Min(build_serial, get_time_in_seconds() - start);
+
+		perm.used = perm_used;
+		start = get_time_in_seconds();
+		bvh = build_bvh(&perm, parsed.scene, pool);
+		build_parallel = Min(build_parallel, get_time_in_seconds() - start);
+	}
+	printf("%s: %lld triangles, %lld nodes\n", file_name, bvh->triangles_count, bvh->nodes_count);
+	printf("Build: %.2f ms on 1 thread, %.2f ms on %d threads\n", build_serial * 1000.0, build_parallel * 1000.0, pool->worker_count + 1);
+
+	S64 rays_count = (S64)BENCH_IMAGE_SIZE * BENCH_IMAGE_SIZE;
+	BVH_Ray *rays = (BVH_Ray*)arena_alloc(&perm, sizeof(BVH_Ray) * rays_count);
+	Ray_Batch batch = {bvh, rays, (BVH_Hit*)arena_alloc(&perm, sizeof(BVH_Hit) * rays_count), (U32*)arena_alloc(&perm, sizeof(U32) * rays_count / 4), rays_count, false};
+
+	const char *ray_kinds[] = {"Primary", "Random"};
+	for (S32 kind = 0; kind < 2; kind += 1) {
+		if (kind == 0) {
+			make_camera_rays(rays, &parsed.scene->bounds);
+		} else {
+			make_random_rays(rays, rays_count, &parsed.scene->bounds);
+		}
+		S64 hits_count;
+		batch.packets = false;
+		F64 single = trace_rays(&batch, NULL, &hits_count);
+		batch.packets = true;
+		F64 packets = trace_rays(&batch, NULL, &hits_count);
+		F64 packets_parallel = trace_rays(&batch, pool, &hits_count);
+		printf("%s rays: %.2f Mrays/s single, %.2f Mrays/s packets, %.2f Mrays/s packets on %d threads, %.1f%% hit, %lld mismatches\n",
+		       ray_kinds[kind], single / 1e6, packets / 1e6, packets_parallel / 1e6, pool->worker_count + 1,
+		       100.0 * hits_count / rays_count, count_mismatches(bvh, rays, rays_count, 1e-5f * parsed.scene->bounds.radius));
+	}
+	return 0;
+}
@@ -2,19 +2,101 @@
 #include "basic_math.cpp"
 #include "parser.cpp"
 
-int main(void) {
+// parse [--mt] [--vertex-cache-stats] [--check-quantization] [file.obj]    Defaults to ../res/test.obj.
+//   --mt                    Parses in parallel.
+//   --vertex-cache-stats    Parses again with PARSE_FLAG_OPTIMIZE_VERTEX_CACHE and prints the ACMR and ATVR of a 16
+//                           entry FIFO cache before and after.
+//   --check-quantization    Parses again with OBJ_Vertex_Q16 and prints the largest errors against the float vertices.
+//                           Fails if a position is off by more than the bound.
+//
+// Built with PROFILE defined it prints the profile of the parse and writes it to profile_trace.json. With --mt the trace
+// has a track per thread.
+
+// Prints the vertex cache statistics of the parsed scene next to those of the same file parsed with the vertex cache
+// optimization. Returns false if that parse fails.
+bool print_vertex_cache_stats(OBJ_Scene *scene, char *file_name, U32 flags) {
+	OBJ_Vertex_Cache_Stats before = get_vertex_cache_stats(scene);
+
+	Arena arena;
+	arena_init(&arena);
+	Parse_Result optimized = parse(&arena, file_name, flags | PARSE_FLAG_OPTIMIZE_VERTEX_CACHE);
+	if (optimized.success) {
+		OBJ_Vertex_Cache_Stats after = get_vertex_cache_stats(optimized.scene);
+		printf("Vertex cache, 16 entry FIFO, %lld triangle(s): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+		       (long long)before.triangles_count, before.acmr, after.acmr, before.atvr, after.atvr);
+	}
+	release_parse_result(&optimized);
+	arena_release(&arena);
+	return optimized.success;
+}
+
+// Compares the parsed scene to the same file parsed with OBJ_Vertex_Q16. Returns false if that parse fails or a position
+// error exceeds its bound.
+bool check_quantization(OBJ_Scene *scene, char *file_name, U32 flags) {
+	Arena arena;
+	arena_init(&arena);
+	Parse_Result quantized = parse<OBJ_Vertex_Q16>(&arena, file_name, flags);
+	OBJ_Quantization_Error error;
+	bool success = quantized.success && get_quantization_error(quantized.scene, scene, &error);
+	if (success) {
+		success = error.position <= error.position_bound;
+		printf("Quantization, %lld vertices: position %.6f (bound %.6f), normal %.4f degrees, tex coord %.6f%s\n",
+		       (long long)error.vertices_count, error.position, error.position_bound, error.normal_degrees, error.tex_coord,
+		       success ? "" : " - position error above the bound!");
+	} else {
+		printf("Quantization: the quantized scene doesn't match the float one.\n");
+	}
+	release_parse_result(&quantized);
+	arena_release(&arena);
+	return success;
+}
+
+int main(int argc, char **argv) {
 	Arena perm;
-	arena_init(&perm, Megabytes(1));
+	arena_init(&perm, Megabytes(1), ARENA_FLAG_LARGE_PAGES);
 
-	char *file_name = "../res/test.obj";
+	char *file_name = (char*)"../res/test.obj";
+	U32 flags = PARSE_FLAG_NONE;
+	bool vertex_cache_stats = false;
+	bool quantization = false;
+	for (int i = 1; i < argc; i += 1) {
+		if (0 == strcmp(argv[i], "--mt")) {
+			flags |= PARSE_FLAG_MULTITHREADED;
+		} else if (0 == strcmp(argv[i], "--vertex-cache-stats")) {
+			vertex_cache_stats = true;
+		} else if (0 == strcmp(argv[i], "--check-quantization")) {
+			quantization = true;
+		} else {
+			file_name = argv[i];
+		}
+	}
 	printf("Starting parse of %s.\n", file_name);
 
+#if defined(PROFILE)
+	profile_begin(true);
+#endif
+
 	double start = get_time_in_seconds();
-	Parse_Result parsed = parse(&perm, file_name);
+	Parse_Result parsed = parse(&perm, file_name, flags);
 	double end = get_time_in_seconds();
 
+#if defined(PROFILE)
+	profile_end();
+	profile_print(stdout);
+	if (!profile_write_chrome_trace("profile_trace.json")) {
+		printf("Could not write profile_trace.json.\n");
+	}
+#endif
+
 	printf("\n%s ", parsed.success ? "Success!" : "Error!");
-	printf("Parsed %llu line(s) in %.3f ms\n", parsed.lines_parsed, (end - start) * 1000.0);
+	printf("Parsed %lld line(s) in %.3f ms\n", (long long)parsed.lines_parsed, (end - start) * 1000.0);
 
-	return !parsed.success;
-}
\ No newline at end of file
+	bool success = parsed.success;
+	if (success && vertex_cache_stats) {
+		success = print_vertex_cache_stats(parsed.scene, file_name, flags);
+	}
+	if (success && quantization) {
+		success = check_quantization(parsed.scene, file_name, flags);
+	}
+	return !success;
+}
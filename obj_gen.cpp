@@ -0,0 +1,82 @@
+#include "basic.cpp"
+#include "basic_math.cpp"
+#include "obj_generator.cpp"
+
+// Writes a synthetic obj file, see obj_generator.cpp.
+//
+//   obj_gen [options] file.obj
+//     --seed N            Random seed (default 1).
+//     --lines N           About this many lines (default 1000000).
+//     --objects N         Number of objects (default 16).
+//     --vt R, --vn R      vt and vn statements per v statement (default 1).
+//     --faces STYLE       v, v/vt, v//vn or v/vt/vn (default v/vt/vn).
+//     --arity N           Corners per face (default 3). parse only reads triangles, so other arities write files that
+//                         are only for other obj readers, and parse rejects them.
+//     --precision N       Digits after the decimal point (default 6).
+//     --exponents R       Share of numbers in scientific notation (default 0).
+//     --plus-signs R      Share of positive numbers with a leading + (default 0).
+//     --comments R        Comment lines per statement (default 0).
+
+char *face_styles[] = {"v", "v/vt", "v//vn", "v/vt/vn"};
+
+int main(int argc, char **argv) {
+	OBJ_Generator_Options options = make_generator_options();
+	char *file_name = NULL;
+	bool usage = false;
+	for (int i = 1; i < argc && !usage; i += 1) {
+		char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+		bool takes_value = true;
+		if (0 == strcmp(argv[i], "--seed") && value) {
+			options.seed = strtoull(value, NULL, 10);
+		} else if (0 == strcmp(argv[i], "--lines") && value) {
+			options.lines_count = atoll(value);
+		} else if (0 == strcmp(argv[i], "--objects") && value) {
+			options.objects_count = atoll(value);
+		} else if (0 == strcmp(argv[i], "--vt") && value) {
+			options.tex_coords_ratio = (F32)atof(value);
+		} else if (0 == strcmp(argv[i], "--vn") && value) {
+			options.normals_ratio = (F32)atof(value);
+		} else if (0 == strcmp(argv[i], "--faces") && value) {
+			options.face_style = U32_MAX;
+			for (U32 style = 0; style < ArrayLen(face_styles); style += 1) {
+				if (0 == strcmp(value, face_styles[style])) {
+					options.face_style = style;
+				}
+			}
+		} else if (0 == strcmp(argv[i], "--arity") && value) {
+			options.arity = atoi(value);
+		} else if (0 == strcmp(argv[i], "--precision") && value) {
+			options.precision = atoi(value);
+		} else if (0 == strcmp(argv[i], "--exponents") && value) {
+			options.exponent_ratio = (F32)atof(value);
+		} else if (0 == strcmp(argv[i], "--plus-signs") && value) {
+			options.plus_sign_ratio = (F32)atof(value);
+		} else if (0 == strcmp(argv[i], "--comments") && value) {
+			options.comment_ratio = (F32)atof(value);
+		} else if (argv[i][0] != '-' && !file_name) {
+			file_name = argv[i];
+			takes_value = false;
+		} else {
+			usage = true;
+		}
+		i += takes_value;
+	}
+	if (usage || !file_name) {
+		fprintf(stderr, "Usage: obj_gen [--seed N] [--lines N] [--objects N] [--vt R] [--vn R] [--faces v|v/vt|v//vn|v/vt/vn]\n"
+		                "               [--arity N] [--precision N] [--exponents R] [--plus-signs R] [--comments R] file.obj\n");
+		return 1;
+	}
+
+	if (options.arity != 3) {
+		fprintf(stderr, "Warning: parse only reads triangles and will reject this file. --arity %d is for other obj readers.\n", options.arity);
+	}
+
+	F64 start = get_time_in_seconds();
+	S64 lines_count;
+	if (!generate_obj_file(file_name, &options, &lines_count)) {
+		fprintf(stderr, "Error! Could not write %s, or the options don't fit together.\n", file_name);
+		return 1;
+	}
+	printf("Wrote %lld line(s) to %s in %.3f s\n", (long long)lines_count, file_name, get_time_in_seconds() - start);
+	return 0;
+}
@@ -0,0 +1,274 @@
+//
+// Synthetic obj files
+//
+// Writes deterministic obj files of any size for benchmarks and for testing the multithreaded and streaming paths at
+// scale. The same options and seed always give the same file. Every object is a grid of positions, a little bumpy, with
+// its faces walking the grid cells. Texture coordinates and normals are separate lists whose lengths are a ratio of the
+// positions, and face corners map onto them proportionally.
+//
+// NOTE(Jan): The parser only reads triangles and rejects files written with any other arity. Those are for other obj
+// readers and for exercising the parser's error path, never for benchmarking it.
+
+enum OBJ_Generator_Face_Style {
+	OBJ_GENERATOR_FACE_V,        // f 1 2 3
+	OBJ_GENERATOR_FACE_V_VT,     // f 1/1 2/2 3/3
+	OBJ_GENERATOR_FACE_V_VN,     // f 1//1 2//2 3//3
+	OBJ_GENERATOR_FACE_V_VT_VN,  // f 1/1/1 2/2/2 3/3/3
+};
+
+typedef struct OBJ_Generator_Options OBJ_Generator_Options;
+struct OBJ_Generator_Options {
+	U64 seed;
+	S64 lines_count;       // About this many lines. The objects are sized from it.
+	S64 objects_count;     // Each with its own o statement, all about the same size.
+	F32 tex_coords_ratio;  // vt statements per v statement. Must be above 0 for face styles with vt.
+	F32 normals_ratio;     // vn statements per v statement. Must be above 0 for face styles with vn.
+	U32 face_style;        // OBJ_Generator_Face_Style
+	S32 arity;             // Corners per face, 3 to OBJ_GENERATOR_MAX_ARITY. parse() only reads 3.
+	S32 precision;         // Digits after the decimal point.
+	F32 exponent_ratio;    // Share of numbers written like 1.250000e-01.
+	F32 plus_sign_ratio;   // Share of positive numbers written with a leading +.
+	F32 comment_ratio;     // Comment lines per statement, half of them trailing a statement instead.
+};
+
+OBJ_Generator_Options make_generator_options(void) {
+	OBJ_Generator_Options options = {};
+	options.seed = 1;
+	options.lines_count = 1000000;
+	options.objects_count = 16;
+	options.tex_coords_ratio = 1.0f;
+	options.normals_ratio = 1.0f;
+	options.face_style = OBJ_GENERATOR_FACE_V_VT_VN;
+	options.arity = 3;
+	options.precision = 6;
+	return options;
+}
+
+#define OBJ_GENERATOR_BUFFER_SIZE Megabytes(4)
+#define OBJ_GENERATOR_MAX_LINE 4096
+#define OBJ_GENERATOR_MAX_ARITY 32
+
+typedef struct OBJ_Generator OBJ_Generator;
+struct OBJ_Generator {
+	OBJ_Generator_Options *options;
+	U64 random_state;
+	FILE *file;
+	char *buffer;
+	char *at;
+	S64 lines_count;
+	bool success;
+};
+
+// xorshift64*
+U64 generator_random_u64(OBJ_Generator *g) {
+	g->random_state ^= g->random_state >> 12;
+	g->random_state ^= g->random_state << 25;
+	g->random_state ^= g->random_state >> 27;
+	return g->random_state * 0x2545f4914f6cdd1dULL;
+}
+
+// In [0, 1).
+F32 generator_random_f32(OBJ_Generator *g) {
+	return (F32)(generator_random_u64(g) >> 40) * (1.0f / 16777216.0f);
+}
+
+bool generator_chance(OBJ_Generator *g, F32 probability) {
+	return probability > 0.0f && generator_random_f32(g) < probability;
+}
+
+// Makes sure the next line fits into the buffer.
+void generator_reserve_line(OBJ_Generator *g) {
+	if (g->at - g->buffer > OBJ_GENERATOR_BUFFER_SIZE - OBJ_GENERATOR_MAX_LINE) {
+		g->success = g->success && fwrite(g->buffer, 1, g->at - g->buffer, g->file) == (size_t)(g->at - g->buffer);
+		g->at = g->buffer;
+	}
+}
+
+void generator_write_string(OBJ_Generator *g, char *string) {
+	size_t len = strlen(string);
+	MemoryCopy(g->at, string, len);
+	g->at += len;
+}
+
+void generator_write_u64(OBJ_Generator *g, U64 value) {
+	char digits[20];
+	S32 count = 0;
+	do {
+		digits[count++] = (char)('0' + value % 10);
+		value /= 10;
+	} while (value);
+	while (count) {
+		*g->at++ = digits[--count];
+	}
+}
+
+void generator_write_f32(OBJ_Generator *g, F32 value) {
+	OBJ_Generator_Options *options = g->options;
+	bool exponent = generator_chance(g, options->exponent_ratio);
+	bool plus_sign = value >= 0.0f && generator_chance(g, options->plus_sign_ratio);
+	*g->at++ = ' ';
+	if (plus_sign) {
+		*g->at++ = '+';
+	}
+	g->at += snprintf(g->at, 64, exponent ? "%.*e" : "%.*f", options->precision, value);
+}
+
+// Ends a statement, sometimes with a trailing comment, and sometimes adds a comment line after it.
+void generator_end_statement(OBJ_Generator *g) {
+	F32 comment_ratio = g->options->comment_ratio * 0.5f;
+	if (generator_chance(g, comment_ratio)) {
+		generator_write_string(g, " # trailing comment");
+	}
+	*g->at++ = '\n';
+	g->lines_count += 1;
+	// Ratios past 1 write several comment lines.
+	for (F32 comments = comment_ratio; comments > 0.0f; comments -= 1.0f) {
+		if (generator_chance(g, Min(comments, 1.0f))) {
+			generator_reserve_line(g);
+			generator_write_string(g, "# A comment line, skipped like whitespace.\n");
+			g->lines_count += 1;
+		}
+	}
+	generator_reserve_line(g);
+}
+
+void generator_write_corner(OBJ_Generator *g, S64 position, S64 positions_count, S64 tex_coords_count, S64 normals_count,
+                            S64 first_position, S64 first_tex_coord, S64 first_normal) {
+	U32 face_style = g->options->face_style;
+	*g->at++ = ' ';
+	generator_write_u64(g, first_position + position);
+	if (face_style == OBJ_GENERATOR_FACE_V_VT || face_style == OBJ_GENERATOR_FACE_V_VT_VN) {
+		*g->at++ = '/';
+		generator_write_u64(g, first_tex_coord + position * tex_coords_count / positions_count);
+	}
+	if (face_style == OBJ_GENERATOR_FACE_V_VN || face_style == OBJ_GENERATOR_FACE_V_VT_VN) {
+		*g->at++ = '/';
+		if (face_style == OBJ_GENERATOR_FACE_V_VN) {
+			*g->at++ = '/';
+		}
+		generator_write_u64(g, first_normal + position * normals_count / positions_count);
+	}
+}
+
+// The grid is width positions wide. Triangles and quads cover its cells, larger faces run along its rows and share
+// their first and last corners with their neighbours.
+void generator_write_faces(OBJ_Generator *g, S64 width, S64 positions_count, S64 tex_coords_count, S64 normals_count,
+                           S64 first_position, S64 first_tex_coord, S64 first_normal) {
+	S32 arity = g->options->arity;
+	S64 height = positions_count / width;
+	S64 corners[OBJ_GENERATOR_MAX_ARITY];
+	for (S64 y = 0; y + 1 < height; y += 1) {
+		S64 step = (arity <= 4) ? 1 : arity - 1;
+		for (S64 x = 0; x + step < width; x += step) {
+			S64 a = y * width + x;
+			S32 faces_count = 1;
+			if (arity == 3) {
+				S64 cell[6] = {a, a + 1, a + width + 1, a, a + width + 1, a + width};
+				MemoryCopy(corners, cell, sizeof(cell));
+				faces_count = 2;
+			} else if (arity == 4) {
+				S64 cell[4] = {a, a + 1, a + width + 1, a + width};
+				MemoryCopy(corners, cell, sizeof(cell));
+			} else {
+				for (S32 k = 0; k < arity; k += 1) {
+					corners[k] = a + k;
+				}
+			}
+			for (S32 face = 0; face < faces_count; face += 1) {
+				generator_write_string(g, "f");
+				for (S32 k = 0; k < arity; k += 1) {
+					generator_write_corner(g, corners[face * arity + k], positions_count, tex_coords_count, normals_count,
+					                       first_position, first_tex_coord, first_normal);
+				}
+				generator_end_statement(g);
+			}
+		}
+	}
+}
+
+// Faces per position for the grid, to size the objects. Larger faces only use every (arity - 1)th position of a row.
+F32 generator_faces_per_position(S32 arity) {
+	return (arity == 3) ? 2.0f : (arity == 4) ? 1.0f : 1.0f / (F32)(arity - 1);
+}
+
+// Writes the file. Returns false if the options are invalid or the file can't be written. lines_count is optional.
+bool generate_obj_file(char *file_name, OBJ_Generator_Options *options, S64 *lines_count = NULL) {
+	U32 face_style = options->face_style;
+	bool uses_tex_coords = face_style == OBJ_GENERATOR_FACE_V_VT || face_style == OBJ_GENERATOR_FACE_V_VT_VN;
+	bool uses_normals = face_style == OBJ_GENERATOR_FACE_V_VN || face_style == OBJ_GENERATOR_FACE_V_VT_VN;
+	if (face_style > OBJ_GENERATOR_FACE_V_VT_VN || options->arity < 3 || options->arity > OBJ_GENERATOR_MAX_ARITY ||
+	    options->objects_count < 1 || options->lines_count < 0 || options->precision < 0 || options->precision > 9 ||
+	    (uses_tex_coords && options->tex_coords_ratio <= 0.0f) || (uses_normals && options->normals_ratio <= 0.0f) ||
+	    options->tex_coords_ratio < 0.0f || options->normals_ratio < 0.0f || options->comment_ratio < 0.0f) {
+		return false;
+	}
+
+	OBJ_Generator g = {};
+	g.options = options;
+	g.random_state = options->seed * 0x9e3779b97f4a7c15ULL + 0x6a09e667f3bcc909ULL; // Never 0 for small seeds.
+	g.file = fopen(file_name, "wb");
+	if (!g.file) {
+		return false;
+	}
+	g.buffer = (char*)malloc(OBJ_GENERATOR_BUFFER_SIZE);
+	g.at = g.buffer;
+	g.success = g.buffer != NULL;
+
+	// Statements per position, with the comment lines between them, give the size of the grid.
+	F32 statements_per_position = 1.0f + options->tex_coords_ratio + options->normals_ratio + generator_faces_per_position(options->arity);
+	F32 lines_per_object = (F32)options->lines_count / (F32)options->objects_count;
+	S64 positions_count = (S64)(lines_per_object / (statements_per_position * (1.0f + 0.5f * options->comment_ratio)));
+	S64 width = Max((S64)sqrt_f32((F32)positions_count), (S64)options->arity);
+	positions_count = Max(positions_count / width, 2) * width;
+	S64 tex_coords_count = Max((S64)((F32)positions_count * options->tex_coords_ratio), (S64)uses_tex_coords);
+	S64 normals_count = Max((S64)((F32)positions_count * options->normals_ratio), (S64)uses_normals);
+
+	S64 first_position = 1, first_tex_coord = 1, first_normal = 1;
+	generator_reserve_line(&g);
+	for (S64 o = 0; g.success && o < options->objects_count; o += 1) {
+		generator_write_string(&g, "o object_");
+		generator_write_u64(&g, o);
+		generator_end_statement(&g);
+
+		// Objects sit next to each other along x, centered on the origin so that about half the numbers are negative.
+		F32 offset = ((F32)o - 0.5f * (F32)(options->objects_count - 1)) * 1.25f;
+		for (S64 i = 0; i < positions_count; i += 1) {
+			F32 x = (F32)(i % width) / (F32)width - 0.5f;
+			F32 z = (F32)(i / width) / (F32)width - 0.5f;
+			generator_write_string(&g, "v");
+			generator_write_f32(&g, offset + x);
+			generator_write_f32(&g, (generator_random_f32(&g) - 0.5f) * 0.05f);
+			generator_write_f32(&g, z);
+			generator_end_statement(&g);
+		}
+		for (S64 i = 0; i < tex_coords_count; i += 1) {
+			generator_write_string(&g, "vt");
+			generator_write_f32(&g, generator_random_f32(&g));
+			generator_write_f32(&g, generator_random_f32(&g));
+			generator_end_statement(&g);
+		}
+		for (S64 i = 0; i < normals_count; i += 1) {
+			Vec3F32 normal = normalize_3f32({generator_random_f32(&g) - 0.5f, 4.0f, generator_random_f32(&g) - 0.5f});
+			generator_write_string(&g, "vn");
+			generator_write_f32(&g, normal.x);
+			generator_write_f32(&g, normal.y);
+			generator_write_f32(&g, normal.z);
+			generator_end_statement(&g);
+		}
+		generator_write_faces(&g, width, positions_count, tex_coords_count, normals_count, first_position, first_tex_coord, first_normal);
+
+		first_position += positions_count;
+		first_tex_coord += tex_coords_count;
+		first_normal += normals_count;
+	}
+
+	if (g.success) {
+		g.success = fwrite(g.buffer, 1, g.at - g.buffer, g.file) == (size_t)(g.at - g.buffer);
+	}
+	g.success = (fclose(g.file) == 0) && g.success;
+	free(g.buffer);
+	if (lines_count) {
+		*lines_count = g.lines_count;
+	}
+	return g.success;
+}
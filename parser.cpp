@@ -3,10 +3,221 @@ typedef struct OBJ_Group OBJ_Group;
 typedef struct OBJ_Vertex OBJ_Vertex;
 typedef U32 OBJ_Index;
 
+// Vertex layouts. parse<Vertex>() builds the vertices of every object in the given layout and only converts the
+// attributes the layout contains. OBJ_Vertex, the default, holds everything the file can specify.
+enum OBJ_Vertex_Layout {
+	OBJ_VERTEX_LAYOUT_P4N3T3,
+	OBJ_VERTEX_LAYOUT_P3,
+	OBJ_VERTEX_LAYOUT_P3N3,
+	OBJ_VERTEX_LAYOUT_P3N3T2,
+	OBJ_VERTEX_LAYOUT_Q16,
+	OBJ_VERTEX_LAYOUT_COUNT,
+};
+
+enum OBJ_Vertex_Attributes {
+	OBJ_VERTEX_TEX_COORD   = (1 << 0),
+	OBJ_VERTEX_NORMAL      = (1 << 1),
+	OBJ_VERTEX_POSITION_W  = (1 << 2), // Positions have 4 components.
+	OBJ_VERTEX_TEX_COORD_W = (1 << 3), // Texture coordinates have 3 components.
+	OBJ_VERTEX_QUANTIZED   = (1 << 4), // Positions are stored relative to the object's OBJ_Quantization.
+};
+
+// Decodes the positions of quantized layouts: position = position_offset + quantized * position_scale.
+typedef struct OBJ_Quantization OBJ_Quantization;
+struct OBJ_Quantization {
+	Vec3F32 position_offset;
+	Vec3F32 position_scale;
+};
+
+// Axis aligned box and bounding sphere of the positions of an object or a scene. All zero without any positions.
+typedef struct OBJ_Bounds OBJ_Bounds;
+struct OBJ_Bounds {
+	Vec3F32 min;
+	Vec3F32 max;
+	Vec3F32 center;
+	F32 radius;
+};
+
+// Octahedral normal encoding: the unit sphere is projected onto the octahedron |x| + |y| + |z| = 1, whose lower half is
+// folded over the upper one, which maps it onto the square [-1, 1]^2.
+F32 sign_not_zero(F32 value) {
+	return (value >= 0.0f) ? 1.0f : -1.0f;
+}
+
+Vec3F32 decode_octahedral(S16 x, S16 y) {
+	Vec3F32 n = {Max((F32)x / 32767.0f, -1.0f), Max((F32)y / 32767.0f, -1.0f), 0.0f};
+	n.z = 1.0f - Abs(n.x) - Abs(n.y);
+	if (n.z < 0.0f) {
+		F32 folded_x = (1.0f - Abs(n.y)) * sign_not_zero(n.x);
+		n.y = (1.0f - Abs(n.x)) * sign_not_zero(n.y);
+		n.x = folded_x;
+	}
+	return normalize_3f32(n);
+}
+
+// Tries every rounding direction and keeps the code whose decoded normal is closest to the input. A zero normal
+// encodes as (0, 0), which decodes to +z.
+void encode_octahedral(Vec3F32 normal, S16 *result) {
+	F32 l1 = Abs(normal.x) + Abs(normal.y) + Abs(normal.z);
+	result[0] = result[1] = 0;
+	if (l1 == 0.0f) {
+		return;
+	}
+	F32 x = normal.x / l1;
+	F32 y = normal.y / l1;
+	if (normal.z < 0.0f) {
+		F32 folded_x = (1.0f - Abs(y)) * sign_not_zero(x);
+		y = (1.0f - Abs(x)) * sign_not_zero(y);
+		x = folded_x;
+	}
+	Vec3F32 unit = normalize_3f32(normal);
+	F32 x_floor = floor_f32(Clamp(x, -1.0f, 1.0f) * 32767.0f);
+	F32 y_floor = floor_f32(Clamp(y, -1.0f, 1.0f) * 32767.0f);
+	F32 best = -2.0f;
+	for (S32 i = 0; i < 4; i += 1) {
+		S16 code_x = (S16)Clamp(x_floor + (F32)(i & 1), -32767.0f, 32767.0f);
+		S16 code_y = (S16)Clamp(y_floor + (F32)(i >> 1), -32767.0f, 32767.0f);
+		F32 similarity = dot_3f32(decode_octahedral(code_x, code_y), unit);
+		if (similarity > best) {
+			best = similarity;
+			result[0] = code_x;
+			result[1] = code_y;
+		}
+	}
+}
+
+U16 quantize_unorm16(F32 value, F32 offset, F32 scale) {
+	if (scale == 0.0f) {
+		return 0;
+	}
+	return (U16)Clamp(floor_f32((value - offset) / scale + 0.5f), 0.0f, 65535.0f);
+}
+
 struct OBJ_Vertex {
 	Vec4F32 v;
 	Vec3F32 vt;
 	Vec3F32 vn;
+
+	static const U32 layout = OBJ_VERTEX_LAYOUT_P4N3T3;
+	static const U32 attributes = OBJ_VERTEX_TEX_COORD | OBJ_VERTEX_NORMAL | OBJ_VERTEX_POSITION_W | OBJ_VERTEX_TEX_COORD_W;
+	static OBJ_Vertex make(Vec4F32 v, Vec3F32 vt, Vec3F32 vn, OBJ_Quantization *quantization) {
+		return {v, vt, vn};
+	}
+};
+
+typedef struct OBJ_Vertex_P3 OBJ_Vertex_P3;
+struct OBJ_Vertex_P3 {
+	Vec3F32 v;
+
+	static const U32 layout = OBJ_VERTEX_LAYOUT_P3;
+	static const U32 attributes = 0;
+	static OBJ_Vertex_P3 make(Vec4F32 v, Vec3F32 vt, Vec3F32 vn, OBJ_Quantization *quantization) {
+		return {{v.x, v.y, v.z}};
+	}
+};
+
+typedef struct OBJ_Vertex_P3N3 OBJ_Vertex_P3N3;
+struct OBJ_Vertex_P3N3 {
+	Vec3F32 v;
+	Vec3F32 vn;
+
+	static const U32 layout = OBJ_VERTEX_LAYOUT_P3N3;
+	static const U32 attributes = OBJ_VERTEX_NORMAL;
+	static OBJ_Vertex_P3N3 make(Vec4F32 v, Vec3F32 vt, Vec3F32 vn, OBJ_Quantization *quantization) {
+		return {{v.x, v.y, v.z}, vn};
+	}
+};
+
+typedef struct OBJ_Vertex_P3N3T2 OBJ_Vertex_P3N3T2;
+struct OBJ_Vertex_P3N3T2 {
+	Vec3F32 v;
+	Vec3F32 vn;
+	Vec2F32 vt;
+
+	static const U32 layout = OBJ_VERTEX_LAYOUT_P3N3T2;
+	static const U32 attributes = OBJ_VERTEX_TEX_COORD | OBJ_VERTEX_NORMAL;
+	static OBJ_Vertex_P3N3T2 make(Vec4F32 v, Vec3F32 vt, Vec3F32 vn, OBJ_Quantization *quantization) {
+		return {{v.x, v.y, v.z}, vn, {vt.x, vt.y}};
+	}
+};
+
+// 16 bytes instead of the 32 of OBJ_Vertex_P3N3T2: unorm16 positions within the bounds of the object, octahedral
+// snorm16 normals, see decode_octahedral(), and half float texture coordinates. See get_quantization_error().
+typedef struct OBJ_Vertex_Q16 OBJ_Vertex_Q16;
+struct OBJ_Vertex_Q16 {
+	U16 v[4]; // v[3] is padding.
+	S16 vn[2];
+	U16 vt[2];
+
+	static const U32 layout = OBJ_VERTEX_LAYOUT_Q16;
+	static const U32 attributes = OBJ_VERTEX_TEX_COORD | OBJ_VERTEX_NORMAL | OBJ_VERTEX_QUANTIZED;
+	static OBJ_Vertex_Q16 make(Vec4F32 v, Vec3F32 vt, Vec3F32 vn, OBJ_Quantization *quantization) {
+		OBJ_Vertex_Q16 result;
+		result.v[0] = quantize_unorm16(v.x, quantization->position_offset.x, quantization->position_scale.x);
+		result.v[1] = quantize_unorm16(v.y, quantization->position_offset.y, quantization->position_scale.y);
+		result.v[2] = quantize_unorm16(v.z, quantization->position_offset.z, quantization->position_scale.z);
+		result.v[3] = 0;
+		encode_octahedral(vn, result.vn);
+		result.vt[0] = f32_to_f16(vt.x);
+		result.vt[1] = f32_to_f16(vt.y);
+		return result;
+	}
+};
+
+// Structure of arrays form of the vertices of an object, see PARSE_FLAG_SOA. Each stream is 64 byte aligned and holds
+// padded_count values, a multiple of OBJ_VERTEX_STREAM_WIDTH. The padding repeats the last vertex, so full width loops
+// need no tail and padding doesn't change e.g. bounds. Streams the vertex layout doesn't contain are NULL.
+#define OBJ_VERTEX_STREAM_WIDTH 16
+
+typedef struct OBJ_Vertex_Streams OBJ_Vertex_Streams;
+struct OBJ_Vertex_Streams {
+	F32 *x, *y, *z, *w;
+	F32 *nx, *ny, *nz;
+	F32 *u, *v, *t;
+	S64 padded_count;
+};
+
+U32 obj_vertex_layout_size[OBJ_VERTEX_LAYOUT_COUNT] = {
+	sizeof(OBJ_Vertex),
+	sizeof(OBJ_Vertex_P3),
+	sizeof(OBJ_Vertex_P3N3),
+	sizeof(OBJ_Vertex_P3N3T2),
+	sizeof(OBJ_Vertex_Q16),
+};
+
+// Part of a split object, see PARSE_FLAG_SPLIT_INDICES. Its indices are relative to first_vertex.
+typedef struct OBJ_Submesh OBJ_Submesh;
+struct OBJ_Submesh {
+	S64 first_index;
+	S64 indices_count;
+	S64 first_vertex;
+	S64 vertices_count;
+};
+
+// Objects, or submeshes, with at most this many vertices get 16 bit indices. 0xffff stays free as restart index.
+#define OBJ_INDEX16_MAX_VERTICES 65535
+
+// A cluster of at most OBJ_MESHLET_MAX_VERTICES vertices and OBJ_MESHLET_MAX_TRIANGLES triangles, see
+// PARSE_FLAG_MESHLETS. Its vertices are meshlet_vertices[vertex_offset...], indices of the object's vertices, and its
+// triangles are meshlet_triangles[triangle_offset * 3...], three indices into its vertices each.
+//
+// The normal cone allows backface culling of the whole meshlet: all of it faces away from a camera at position p if
+// dot(normalize(cone_apex - p), cone_axis) >= cone_cutoff. A cutoff of 1 means the cone is too wide to cull.
+#define OBJ_MESHLET_MAX_VERTICES 64
+#define OBJ_MESHLET_MAX_TRIANGLES 124
+
+typedef struct OBJ_Meshlet OBJ_Meshlet;
+struct OBJ_Meshlet {
+	U32 vertex_offset;
+	U32 triangle_offset;
+	U32 vertices_count;
+	U32 triangles_count;
+
+	Vec3F32 center;
+	F32 radius;
+	Vec3F32 cone_apex;
+	Vec3F32 cone_axis;
+	F32 cone_cutoff;
 };
 
 struct OBJ_Group {
@@ -20,10 +231,34 @@ struct OBJ_Group {
 
 struct OBJ_Object {
 	String8 name;
-	OBJ_Vertex *vertices;
-	OBJ_Index *indices;
+	union {
+		OBJ_Vertex *vertices;  // With the default layout.
+		void *vertex_data;     // With any layout, see get_vertices(). NULL with PARSE_FLAG_SOA.
+	};
+	U32 vertex_layout;
+	OBJ_Quantization quantization; // Only with quantized layouts.
+	OBJ_Vertex_Streams streams; // Only with PARSE_FLAG_SOA.
+	union {
+		OBJ_Index *indices; // With an index_size of 4.
+		U16 *indices_u16;   // With an index_size of 2, see PARSE_FLAG_16BIT_INDICES.
+		void *index_data;
+	};
+	U32 index_size;
 	S64 vertices_count;
 	S64 indices_count;
+	OBJ_Submesh *submeshes; // Only for objects split by PARSE_FLAG_SPLIT_INDICES, else NULL.
+	S64 submeshes_count;
+	OBJ_Bounds bounds;
+
+	// Only with PARSE_FLAG_TANGENTS, else NULL. Per vertex, xyz is the unit tangent and w is +1 or -1, so that the
+	// bitangent is w * cross(normal, tangent). See generate_object_tangents().
+	Vec4F32 *tangents;
+
+	// Only with PARSE_FLAG_MESHLETS.
+	OBJ_Meshlet *meshlets;
+	S64 meshlets_count;
+	U32 *meshlet_vertices;
+	U8 *meshlet_triangles;
 
 	OBJ_Group *groups_first;
 	OBJ_Group *groups_last;
@@ -32,10 +267,53 @@ struct OBJ_Object {
 	OBJ_Object *prev;
 };
 
+// Every object name of a scene is stored once, in the scene's arena, and maps to its object.
+typedef struct OBJ_Name_Entry OBJ_Name_Entry;
+struct OBJ_Name_Entry {
+	String8 name;
+	U64 hash;
+	OBJ_Object *object; // NULL for an empty slot.
+};
+
+// Open addressing with linear probing, at most half full.
+typedef struct OBJ_Name_Table OBJ_Name_Table;
+struct OBJ_Name_Table {
+	OBJ_Name_Entry *entries;
+	U64 mask;
+	S64 count;
+};
+
 typedef struct OBJ_Scene OBJ_Scene;
 struct OBJ_Scene {
 	OBJ_Object *objects_first;
 	OBJ_Object *objects_last;
+	OBJ_Bounds bounds; // Of all objects.
+
+	OBJ_Name_Table names;
+};
+
+enum Parse_Flags {
+	PARSE_FLAG_NONE          = 0,
+	PARSE_FLAG_MAP_FILE      = (1 << 0), // Tokenize a read-only mapping of the file instead of a copy in the arena.
+	PARSE_FLAG_MULTITHREADED = (1 << 1), // Parse chunks of the file in parallel. The scene is the same as a serial parse.
+	PARSE_FLAG_CACHE         = (1 << 2), // Load the scene from <file>.scene if it matches the file, else write it.
+	                                     // Layouts other than OBJ_Vertex use <file>.<layout>.scene. Together with
+	                                     // PARSE_FLAG_MAP_FILE a loaded scene is read-only: its vertices and indices
+	                                     // point into the read-only mapping of the cache, and writing them crashes.
+	PARSE_FLAG_SOA           = (1 << 3), // Store vertices as OBJ_Vertex_Streams instead of an array. Not cached.
+	                                     // The streams are F32 with quantized layouts too.
+	PARSE_FLAG_16BIT_INDICES = (1 << 4), // Objects with at most OBJ_INDEX16_MAX_VERTICES vertices get U16 indices.
+	                                     // Not cached.
+	PARSE_FLAG_SPLIT_INDICES = (1 << 5), // Like PARSE_FLAG_16BIT_INDICES, but larger objects are split into submeshes
+	                                     // so that every object gets U16 indices. Not cached.
+	PARSE_FLAG_OPTIMIZE_VERTEX_CACHE = (1 << 6), // Reorder triangles for the post-transform cache and vertices for
+	                                             // fetching, see optimize_vertex_cache(). Not cached.
+	PARSE_FLAG_MESHLETS      = (1 << 7), // Build the meshlets of every object, see OBJ_Meshlet. Not cached.
+	PARSE_FLAG_GENERATE_NORMALS = (1 << 8), // Faces without normals get smooth ones, see generate_normals(). Not cached.
+	PARSE_FLAG_ANGLE_WEIGHTED_NORMALS = (1 << 9), // Like PARSE_FLAG_GENERATE_NORMALS, but faces are weighted by their
+	                                              // angle at the vertex instead of their area.
+	PARSE_FLAG_TANGENTS      = (1 << 10), // Give every vertex a tangent, see OBJ_Object.tangents. Only for layouts with
+	                                      // normals and texture coordinates. Not cached.
 };
 
 typedef struct Parse_Result Parse_Result;
@@ -43,6 +321,11 @@ struct Parse_Result {
 	OBJ_Scene *scene;
 	S64 lines_parsed;
 	bool success;
+
+	// The parsed text, or the scene cache if the scene was loaded from it. With PARSE_FLAG_MAP_FILE this is a read-only
+	// mapping that release_parse_result() unmaps. A scene loaded from the cache points into it, so its vertex and index
+	// arrays must not be written then.
+	File file;
 };
 
 typedef struct Tokenizer Tokenizer;
@@ -55,12 +338,15 @@ struct Tokenizer {
 	char *at;
 	S64 line_number = 1;
 	int last_keyword;
+	bool silent; // Don't print errors.
 };
 
 typedef struct Token Token;
 struct Token {
 	String8 value;
 	int kind;
+	F32 float_value; // Converted value of KIND_FLOAT tokens.
+	S32 element[3];  // v, vt and vn index of KIND_PRIMITIVE_ELEMENT tokens, as written in the file. 0 if absent.
 };
 
 enum Token_Kind {
@@ -72,6 +358,7 @@ enum Token_Kind {
 	KIND_KEYWORD_VT,
 	KIND_KEYWORD_VN,
 	KIND_KEYWORD_F,
+	KIND_KEYWORD_S,
 	KIND_KEYWORD_END,
 	KIND_NAME,
 	KIND_FLOAT,
@@ -94,48 +381,87 @@ Tokenizer make_tokenizer(char *file_name, char *file_data, size_t file_len) {
 	return t;
 }
 
-bool valid_float(String8 word) {
-	int i = 0;
-	bool sign = word.start[i] == '-' || word.start[i] == '+';
-	i += sign;
+// Validates and converts a float in one pass. Accepted forms:
+//   [+-] digits [. [digits]] [(e|E) [+-] digits]
+//   [+-] . digits [(e|E) [+-] digits]
+bool parse_float(String8 word, F32 *value) {
+	ProfileZone("parse_float");
+	char *at = word.start;
+	char *end = word.start + word.len;
+
+	bool negative = false;
+	if (at < end && (*at == '-' || *at == '+')) {
+		negative = *at == '-';
+		at += 1;
+	}
 
-	bool dot = word.len > i && word.start[i] == '.';
-	bool digit = word.len > i && is_digit(word.start[i]);
-	bool next_is_digit = word.len > i + 1 && is_digit(word.start[i + 1]);
-	bool valid = digit || (sign && digit) || (dot && next_is_digit) || (sign && dot && next_is_digit);
-	i += digit + dot + next_is_digit;
+	// Up to 19 significant digits fit into the mantissa. Further integral digits only scale it, further fractional
+	// digits are dropped.
+	U64 mantissa = 0;
+	S64 exponent = 0;
+	int significant_digits = 0;
+	bool truncated = false;
 
-	int decimal_points, e_count;
-	decimal_points = 0;
-	e_count = 0;
-	while (i < word.len && valid && e_count == 0) {
-		e_count += ((word.start[i] == 'e') || (word.start[i] == 'E'));
-		decimal_points += (word.start[i] == '.');
-		if (e_count == 0) {
-			valid = valid && (is_digit(word.start[i]) || word.start[i] == '.') && decimal_points <= 1;
+	char *digits_start = at;
+	while (at < end && is_digit(*at)) {
+		if (significant_digits < 19) {
+			mantissa = mantissa * 10 + (U64)(*at - '0');
+			significant_digits += (mantissa != 0);
+		} else {
+			truncated = truncated || *at != '0';
+			exponent += 1;
 		}
-		i += 1;
+		at += 1;
 	}
+	S64 digit_count = at - digits_start;
 
-	if (valid && e_count == 1) {
-		valid = valid && word.len > i && is_digit(word.start[i]);
-		if (!valid) {
-			valid = (word.start[i] == '-' || word.start[i] == '+') && word.len > i + 1 && is_digit(word.start[i + 1]);
-			i += 1;
+	if (at < end && *at == '.') {
+		at += 1;
+		digits_start = at;
+		while (at < end && is_digit(*at)) {
+			if (significant_digits < 19) {
+				mantissa = mantissa * 10 + (U64)(*at - '0');
+				significant_digits += (mantissa != 0);
+				exponent -= 1;
+			} else {
+				truncated = truncated || *at != '0';
+			}
+			at += 1;
 		}
+		digit_count += at - digits_start;
+	}
+
+	bool valid = digit_count > 0;
 
-		while (i < word.len && valid) {
-			e_count += ((word.start[i] == 'e') || (word.start[i] == 'E'));
-			valid = valid && e_count == 1 && is_digit(word.start[i]);
-			i += 1;
+	if (valid && at < end && (*at == 'e' || *at == 'E')) {
+		at += 1;
+		bool negative_exponent = false;
+		if (at < end && (*at == '-' || *at == '+')) {
+			negative_exponent = *at == '-';
+			at += 1;
+		}
+		valid = at < end && is_digit(*at);
+		S64 exponent_value = 0;
+		while (at < end && is_digit(*at)) {
+			// Anything this large is zero or infinity anyway.
+			if (exponent_value < 100000) {
+				exponent_value = exponent_value * 10 + (*at - '0');
+			}
+			at += 1;
 		}
+		exponent += negative_exponent ? -exponent_value : exponent_value;
 	}
 
+	valid = valid && at == end;
+	if (valid) {
+		*value = decimal_to_f32(mantissa, exponent, negative, truncated, word.start, (int)word.len);
+	}
 	return valid;
 }
 
 bool valid_int(String8 word) {
-	int i = 0;
+	ProfileZone("valid_int");
+	size_t i = 0;
 	bool valid, start;
 	valid = word.len > 0;
 	start = true;
@@ -157,107 +483,201 @@ bool valid_int(String8 word) {
 	return valid;
 }
 
-bool valid_primitive_element(String8 word) {
-	// int, int/int, int//int, int/int/int
-	S32 i, first_slash, second_slash;
-	i = 0, first_slash = -1, second_slash = -1;
-	while (i < word.len) {
-		if (first_slash == -1 && word.start[i] == '/') {
-			first_slash = i;
-		} else if (second_slash == -1 && word.start[i] == '/') {
-			second_slash = i;
-		}
-		i += 1;
-	}
+// Parses one index of a primitive element: an optional sign followed by digits without leading zeros.
+// Advances *at past it.
+bool parse_element_index(char **at, char *end, char *limit, S32 *index) {
+	char *c = *at;
+	bool negative = c < end && *c == '-';
+	c += (c < end && (*c == '-' || *c == '+'));
 
-	bool valid = true;
-	if (first_slash == -1) {
-		// int
-		valid = valid_int(word);
-	} else if (first_slash != -1 && second_slash == -1) {
-		// int/int
-		valid = valid_int({word.start, (size_t)first_slash}) && valid_int({word.start + (size_t)first_slash + 1, word.len - (size_t)first_slash - 1});
-	} else if (first_slash != -1 && second_slash != -1 && first_slash + 1 == second_slash) {
-		// int//int
-		valid = valid_int({word.start, (size_t)first_slash}) && valid_int({word.start + (size_t)second_slash + 1, word.len - (size_t)second_slash - 1});
-	} else {
-		// int/int/int
-		valid = valid && valid_int({word.start, (size_t)first_slash});
-		valid = valid && valid_int({word.start + (size_t)first_slash + 1, (size_t)second_slash - (size_t)first_slash - 1});
-		valid = valid && valid_int({word.start + (size_t)second_slash + 1, word.len - (size_t)second_slash - 1});
-	}
+	U64 value;
+	S64 digit_count = parse_digits(c, limit, &value);
+	bool valid = digit_count > 0 && digit_count <= 10 && value <= S32_MAX && c + digit_count <= end;
+	// Only "0" itself may start with a zero.
+	valid = valid && !(*c == '0' && (digit_count > 1 || c != *at));
 
+	*index = negative ? -(S32)value : (S32)value;
+	*at = c + digit_count;
 	return valid;
 }
 
+// Validates and decodes a primitive element in a single pass: v, v/vt, v//vn or v/vt/vn. The slashes are the bytes the
+// digit runs stop at, so the layout falls out of the same scan. element receives {v, vt, vn}, with 0 for the absent
+// ones. limit is the end of the file; the digit scanner may look past the word up to there.
+bool decode_primitive_element(String8 word, char *limit, S32 element[3]) {
+	ProfileZone("decode_primitive_element");
+	char *at = word.start;
+	char *end = word.start + word.len;
+	element[0] = element[1] = element[2] = 0;
+
+	bool valid = parse_element_index(&at, end, limit, &element[0]);
+	if (valid && at < end) {
+		valid = *at == '/';
+		at += 1;
+		bool has_vt = at < end && *at != '/';
+		if (valid && has_vt) {
+			valid = parse_element_index(&at, end, limit, &element[1]);
+		}
+		if (valid && (at < end || !has_vt)) {
+			// v//vn, or the second slash of v/vt/vn.
+			valid = at < end && *at == '/';
+			at += 1;
+			valid = valid && parse_element_index(&at, end, limit, &element[2]);
+		}
+	}
+	return valid && at == end;
+}
+
 bool valid_name(String8 word) {
+	ProfileZone("valid_name");
 	bool valid = word.len > 0 && (is_letter(word.start[0]) || word.start[0] == '_');
-	for (int i = 1; i < word.len && valid; i += 1) {
+	for (size_t i = 1; i < word.len && valid; i += 1) {
 		valid = valid && (is_letter(word.start[i]) || is_digit(word.start[i]) || word.start[i] == '_' || word.start[i] == '.' || word.start[i] == '-');
 	}
 	return valid;
 }
 
-Token next_token(Tokenizer *t) {
-	Token token;
+// Returns the first \r or \n at or after at, or end.
+char *find_end_of_line(char *at, char *end) {
+	while (end - at >= CHAR_BLOCK_SIZE) {
+		Char_Masks masks = classify_char_block(at);
+		U64 end_of_line = masks.line_feed | masks.carriage_return;
+		if (end_of_line) {
+			return at + count_trailing_zeros(end_of_line);
+		}
+		at += CHAR_BLOCK_SIZE;
+	}
+	while (at < end && !is_end_of_line(*at)) {
+		at += 1;
+	}
+	return at;
+}
 
-	String8 text_to_go = {t->at, t->file.len - (t->at - t->file.start)};
+// Advances t->at past whitespace and comments to the start of the next word and counts the lines it crosses. Whole
+// blocks are classified at once while they are in bounds; the tail of the file is handled byte by byte.
+void skip_whitespace_and_comments(Tokenizer *t) {
+	char *at = t->at;
+	char *end = t->file.start + t->file.len;
+	S64 line_number = t->line_number;
 
-	String8 word;
-	S64 offset_by;
+	while (at < end) {
+		if (*at == '#') {
+			// Skip comment up to, but not including, the end of the line.
+			at = find_end_of_line(at, end);
+		} else if (end - at >= CHAR_BLOCK_SIZE) {
+			Char_Masks masks = classify_char_block(at);
+			U64 not_whitespace = ~masks.whitespace & CHAR_BLOCK_FULL_MASK;
+			U32 run = not_whitespace ? count_trailing_zeros(not_whitespace) : CHAR_BLOCK_SIZE;
+			U64 run_mask = (run == 64) ? U64_MAX : ((1ULL << run) - 1);
 
-	// Skip comments and whitespaces.
-	while (t->at < t->file.start + t->file.len) {
-		if (*t->at == '#') {
-			// Skip comment
-			word = get_next_line(text_to_go);
-			t->at += word.len;
-		} else if (is_end_of_line(*t->at)) {
+			// Every \n ends a line, and so does every \r that isn't the first half of a \r\n.
+			U64 lone_carriage_return = masks.carriage_return & ~(masks.line_feed >> 1) & run_mask;
+			if (run == CHAR_BLOCK_SIZE && at + run < end && at[run] == '\n') {
+				// The \n completing a \r\n is in the next block.
+				lone_carriage_return &= ~(1ULL << (CHAR_BLOCK_SIZE - 1));
+			}
+			line_number += count_set_bits(masks.line_feed & run_mask) + count_set_bits(lone_carriage_return);
+			at += run;
+
+			if (run < CHAR_BLOCK_SIZE && *at != '#') {
+				break;
+			}
+		} else if (is_end_of_line(*at)) {
 			// Skip end of line
-			if (*t->at == '\r') {
-				if (t->at + 1 < t->file.start + t->file.len && *(t->at + 1) == '\n') {
-					// \r\n
-					t->at += 2;
-				} else {
-					// \r
-					t->at += 1;
-				}
+			if (*at == '\r' && at + 1 < end && *(at + 1) == '\n') {
+				// \r\n
+				at += 2;
 			} else {
-				// \n
-				t->at += 1;
+				// \r or \n
+				at += 1;
 			}
-			t->line_number += 1;
-		} else if (is_spacing(*t->at)) {
-			t->at += 1;
+			line_number += 1;
+		} else if (is_spacing(*at)) {
+			at += 1;
 		} else {
 			break;
 		}
-		text_to_go = {t->at, t->file.len - (t->at - t->file.start)};
 	}
 
+	t->at = at;
+	t->line_number = line_number;
+}
+
+// Returns the word starting at t->at, which ends at the next whitespace or the end of the file.
+String8 scan_word(Tokenizer *t) {
+	char *at = t->at;
+	char *end = t->file.start + t->file.len;
+
+	while (end - at >= CHAR_BLOCK_SIZE) {
+		Char_Masks masks = classify_char_block(at);
+		if (masks.whitespace) {
+			at += count_trailing_zeros(masks.whitespace);
+			return {t->at, (size_t)(at - t->at)};
+		}
+		at += CHAR_BLOCK_SIZE;
+	}
+	while (at < end && !is_whitespace(*at)) {
+		at += 1;
+	}
+	return {t->at, (size_t)(at - t->at)};
+}
+
+void report_error(Tokenizer *t, char *format, ...) {
+	if (!t->silent) {
+		va_list args;
+		va_start(args, format);
+		printf("%s (%lld): ", t->file_name, t->line_number);
+		vprintf(format, args);
+		va_end(args);
+	}
+}
+
+// Returns the keyword the word spells, or KIND_NONE.
+int keyword_kind(String8 word) {
+	int kind = KIND_NONE;
+	if (0) {
+	} else if (0 == string_compare("o",  word.start, word.len)) {
+		kind = KIND_KEYWORD_O;
+	} else if (0 == string_compare("v",  word.start, word.len)) {
+		kind = KIND_KEYWORD_V;
+	} else if (0 == string_compare("vt", word.start, word.len)) {
+		kind = KIND_KEYWORD_VT;
+	} else if (0 == string_compare("vn", word.start, word.len)) {
+		kind = KIND_KEYWORD_VN;
+	} else if (0 == string_compare("f", word.start, word.len)) {
+		kind = KIND_KEYWORD_F;
+	} else if (0 == string_compare("s", word.start, word.len)) {
+		kind = KIND_KEYWORD_S;
+	}
+	return kind;
+}
+
+Token next_token(Tokenizer *t) {
+	ProfileZone("next_token");
+	Token token = {};
+
+	String8 word;
+	S64 offset_by;
+
+	// Skip comments and whitespaces.
+	skip_whitespace_and_comments(t);
+
 	// Tokenize next word
-	word = get_next_word(text_to_go, " \r\n\t\v\f");
+	word = scan_word(t);
 	if (t->at < t->file.start + t->file.len) {
 		Assert(word.len > 0);
 		char c = word.start[0];
 		if (is_letter(c)) {
 			// Keyword or Name
-			if (0) {
-			} else if (0 == string_compare("o",  word.start, word.len)) {
-				token.kind = KIND_KEYWORD_O;
-			} else if (0 == string_compare("v",  word.start, word.len)) {
-				token.kind = KIND_KEYWORD_V;
-			} else if (0 == string_compare("vt", word.start, word.len)) {
-				token.kind = KIND_KEYWORD_VT;
-			} else if (0 == string_compare("vn", word.start, word.len)) {
-				token.kind = KIND_KEYWORD_VN;
-			} else if (0 == string_compare("f", word.start, word.len)) {
-				token.kind = KIND_KEYWORD_F;
-			} else {
-				if (valid_name(word)) {
+			token.kind = keyword_kind(word);
+			if (token.kind == KIND_NONE) {
+				if (t->last_keyword == KIND_KEYWORD_S && 0 == string_compare("off", word.start, word.len)) {
+					// NOTE(Jan): 's off' is the same as 's 0'.
+					token.kind = KIND_INTEGER;
+				} else if (valid_name(word)) {
 					token.kind = KIND_NAME;
 				} else {
-					printf("%s (%lld): syntax error: Expected a name. Got: %.*s\n", t->file_name, t->line_number, (int)word.len, word.start);
+					report_error(t, "syntax error: Expected a name. Got: %.*s\n", (int)word.len, word.start);
 					token.kind = KIND_NONE;
 				}
 			}
@@ -268,10 +688,10 @@ Token next_token(Tokenizer *t) {
 			// Number or Primitive Element
 			if (t->last_keyword == KIND_KEYWORD_F) {
 				// Primitive element
-				if (valid_primitive_element(word)) {
+				if (decode_primitive_element(word, t->file.start + t->file.len, token.element)) {
 					token.kind = KIND_PRIMITIVE_ELEMENT;
 				} else {
-					printf("%s (%lld): syntax error: Expected a primitive element. Got: %.*s\n", t->file_name, t->line_number, (int)word.len, word.start);
+					report_error(t, "syntax error: Expected a primitive element. Got: %.*s\n", (int)word.len, word.start);
 					token.kind = KIND_NONE;
 				}
 			} else {
@@ -280,14 +700,17 @@ Token next_token(Tokenizer *t) {
 				if (valid_int(word) && t->last_keyword != KIND_KEYWORD_V && t->last_keyword != KIND_KEYWORD_VT && t->last_keyword != KIND_KEYWORD_VN) {
 					// Integer
 					token.kind = KIND_INTEGER;
-				} else if (valid_float(word)) {
+				} else if (parse_float(word, &token.float_value)) {
 					// Float
 					token.kind = KIND_FLOAT;
 				} else {
-					printf("%s (%lld): syntax error: Expected a number. Got: %.*s\n", t->file_name, t->line_number, (int)word.len, word.start);
+					report_error(t, "syntax error: Expected a number. Got: %.*s\n", (int)word.len, word.start);
 					token.kind = KIND_NONE;
 				}
 			}
+		} else {
+			report_error(t, "syntax error: Unexpected: %.*s\n", (int)word.len, word.start);
+			token.kind = KIND_NONE;
 		}
 	} else {
 		// End of file
@@ -311,6 +734,7 @@ char *token_kind_to_string[] = {
 	"vt",
 	"vn",
 	"f",
+	"s",
 	"keyword end",
 	"name",
 	"float",
@@ -323,7 +747,7 @@ char *token_kind_to_string[] = {
 void print_token(Token t) {
 	Arena *scratch = begin_scratch();
 	char *cstring = (char*)arena_alloc(scratch, t.value.len + 1);
-	snprintf(cstring, t.value.len + 1, "%s", t.value.start);
+	snprintf(cstring, t.value.len + 1, "%.*s", (int)t.value.len, t.value.start);
 	printf("[%s, '%s']\n", token_kind_to_string[t.kind], cstring);
 	end_scratch(scratch);
 }
@@ -340,6 +764,7 @@ OBJ_Scene *make_scene(Arena *arena) {
 OBJ_Object *make_object(Arena *arena) {
 	OBJ_Object *object = (OBJ_Object*)arena_alloc(arena, sizeof(*object));
 	MemoryZero(object, sizeof(*object));
+	object->index_size = sizeof(OBJ_Index);
 	return object;
 }
 
@@ -367,39 +792,365 @@ void append_group(OBJ_Object *object, OBJ_Group *group) {
 	}
 }
 
+template <typename Vertex>
+Vertex *get_vertices(OBJ_Object *object) {
+	Assert(object->vertex_layout == Vertex::layout);
+	return (Vertex*)object->vertex_data;
+}
+
+//
+// Name table
+
+void make_name_table(Arena *arena, OBJ_Name_Table *table, S64 max_names) {
+	U64 capacity = (U64)next_power_of(2, max_names * 2);
+	table->entries = (OBJ_Name_Entry*)arena_alloc(arena, sizeof(OBJ_Name_Entry) * capacity);
+	MemoryZero(table->entries, sizeof(OBJ_Name_Entry) * capacity);
+	table->mask = capacity - 1;
+	table->count = 0;
+}
+
+// Returns the entry of the name, or the empty entry where it would be inserted.
+OBJ_Name_Entry *lookup_name(OBJ_Name_Table *table, String8 name, U64 hash) {
+	if (!table->entries) {
+		return NULL;
+	}
+	U64 slot = hash & table->mask;
+	for (;;) {
+		OBJ_Name_Entry *entry = &table->entries[slot];
+		if (!entry->object || (entry->hash == hash && 0 == string_compare(entry->name, name))) {
+			return entry;
+		}
+		slot = (slot + 1) & table->mask;
+	}
+}
+
+// Fills an empty entry returned by lookup_name() with a copy of the name.
+void insert_name(Arena *arena, OBJ_Name_Table *table, OBJ_Name_Entry *entry, String8 name, U64 hash, OBJ_Object *object) {
+	Assert(!entry->object && (U64)(table->count + 1) * 2 <= table->mask + 1);
+	char *copy = (char*)arena_alloc(arena, name.len + 1);
+	MemoryCopy(copy, name.start, name.len);
+	copy[name.len] = 0;
+
+	entry->name = {copy, name.len};
+	entry->hash = hash;
+	entry->object = object;
+	table->count += 1;
+}
+
+OBJ_Object *find_object(OBJ_Scene *scene, String8 name) {
+	OBJ_Name_Entry *entry = lookup_name(&scene->names, name, hash_ascii(name.start, name.len));
+	return entry ? entry->object : NULL;
+}
+
+OBJ_Object *find_object(OBJ_Scene *scene, char *name) {
+	return find_object(scene, {name, strlen(name)});
+}
+
 //
 // Parsing
-Parse_Result parse(Arena *arena, char *file_name) {
-	File file = read_file(arena, file_name);
-	if (!file.success) {
-		printf("Failed to read file %s.\n", file_name);
+//
+// The statement parser turns attributes into the v/vt/vn lists right away, but only records face elements as corners
+// (global v/vt/vn indices) and 'o' statements as segments of corners. Objects, vertices and indices are built from
+// them once the whole file is parsed. That way a parse can be split into chunks that run in parallel.
+//
+// Multithreaded parsing splits the file into chunks that each start at a statement. A first pass counts what every
+// chunk contains, so that each chunk knows the line and the v/vt/vn indices it starts at. Then the chunks are parsed in
+// parallel. Afterwards the segments of all chunks are stitched to objects in file order.
+typedef struct Face_Corner Face_Corner;
+struct Face_Corner {
+	U32 v;
+	U32 vt;
+	U32 vn;
+};
+
+// Smoothing groups of faces, from 's' statements. Faces before the first 's' are smoothed, like those of one group.
+// Chunks other than the first don't know the group they start in until the chunks before them are parsed.
+#define SMOOTHING_GROUP_OFF 0
+#define SMOOTHING_GROUP_NONE U32_MAX
+#define SMOOTHING_GROUP_INHERITED (U32_MAX - 1)
+
+// A run of face corners belonging to the same object.
+typedef struct Chunk_Segment Chunk_Segment;
+struct Chunk_Segment {
+	// Empty for the first segment of a chunk: its corners belong to whatever object was current where the previous
+	// chunk ended.
+	String8 name;
+	S64 first_corner;
+	S64 corners_count;
+
+	// Set when stitching.
+	Face_Corner *corners;
+	U32 *smoothing_groups; // Per face, if the chunk has them.
+	Chunk_Segment *next_in_object;
+};
+
+typedef struct Parse_Chunk Parse_Chunk;
+struct Parse_Chunk {
+	String8 text;
+	bool last;
+
+	// Counted by count_chunk().
+	S64 lines;
+	S64 positions_count;
+	S64 tex_coords_count;
+	S64 normals_count;
+	S64 objects_count;
+
+	// Sums of the counts of all chunks before this one.
+	S64 first_line;
+	S64 first_position;
+	S64 first_tex_coord;
+	S64 first_normal;
+
+	// Filled by parse_statements().
+	Face_Corner *corners;
+	S64 corners_count;
+	S64 corners_capacity;
+	Chunk_Segment *segments;
+	S64 segments_count;
+	S64 segments_capacity;
+	U32 *smoothing_groups; // Per face. Only stored if 's' statements aren't skipped.
+	S64 smoothing_groups_capacity;
+	U32 last_smoothing_group;
+	S64 end_line;
+	bool success;
+};
+
+// Files smaller than this are not worth splitting.
+#define PARSE_CHUNK_MIN_SIZE Megabytes(1)
+
+// Address space reserved per byte of text by the arenas a parse fills. A face corner takes at least two bytes of text,
+// and neither the scene nor the scratch of building it holds much more than 100 bytes per corner. Reserving is cheap, so
+// a file of any size fits.
+#define PARSE_RESERVE_PER_BYTE 64
+
+size_t get_parse_reserve_size(U64 file_size) {
+	return ARENA_RESERVE_SIZE + PARSE_RESERVE_PER_BYTE * file_size;
+}
+
+// Event interface for scans that don't need a scene. Every callback is optional. Statements without a callback are
+// skipped up to the end of their line and not validated, which is what makes a scan for e.g. positions fast. Face
+// corners are reported as 1-based indices into the attributes of the file so far, with negative indices already
+// resolved; 0 means absent.
+typedef struct Parse_Callbacks Parse_Callbacks;
+struct Parse_Callbacks {
+	void *user_data;
+	void (*on_position)(void *user_data, Vec4F32 position);
+	void (*on_tex_coord)(void *user_data, Vec3F32 tex_coord);
+	void (*on_normal)(void *user_data, Vec3F32 normal);
+	void (*on_face_corner)(void *user_data, S64 v_index, S64 vt_index, S64 vn_index);
+	void (*on_object)(void *user_data, String8 name);
+};
+
+// A serial parse does not know how much a file contains. Each growing array gets an arena of its own, so it is always
+// the last allocation of its arena and grows in place: memory is committed as the file is parsed and nothing is
+// copied. A multithreaded parse sizes its lists up front but keeps them apart the same way, so that none of them
+// shares a reservation with the others or with the scratch of building the scene.
+typedef struct Parse_Storage Parse_Storage;
+struct Parse_Storage {
+	Arena positions;
+	Arena tex_coords;
+	Arena normals;
+	Arena corners;
+	Arena segments;
+	Arena smoothing_groups;
+};
+
+// Every list gets room for one element per byte of text. Every statement and face corner takes at least two bytes, and
+// growing by doubling never asks for more than twice the elements there are.
+void init_parse_storage(Parse_Storage *storage, U64 file_size) {
+	arena_init(&storage->positions, Megabytes(1), ARENA_FLAG_NONE, ARENA_RESERVE_SIZE + sizeof(Vec4F32) * file_size);
+	arena_init(&storage->tex_coords, Megabytes(1), ARENA_FLAG_NONE, ARENA_RESERVE_SIZE + sizeof(Vec3F32) * file_size);
+	arena_init(&storage->normals, Megabytes(1), ARENA_FLAG_NONE, ARENA_RESERVE_SIZE + sizeof(Vec3F32) * file_size);
+	arena_init(&storage->corners, Megabytes(1), ARENA_FLAG_NONE, ARENA_RESERVE_SIZE + sizeof(Face_Corner) * file_size);
+	arena_init(&storage->segments, Megabytes(1), ARENA_FLAG_NONE, ARENA_RESERVE_SIZE + sizeof(Chunk_Segment) * file_size);
+	arena_init(&storage->smoothing_groups, Megabytes(1), ARENA_FLAG_NONE, ARENA_RESERVE_SIZE + sizeof(U32) * file_size);
+}
+
+void release_parse_storage(Parse_Storage *storage) {
+	arena_release(&storage->positions);
+	arena_release(&storage->tex_coords);
+	arena_release(&storage->normals);
+	arena_release(&storage->corners);
+	arena_release(&storage->segments);
+	arena_release(&storage->smoothing_groups);
+}
+
+typedef struct Parse_State Parse_State;
+struct Parse_State {
+	Tokenizer tokenizer;
+	Parse_Chunk *chunk;
+
+	// NULL for the chunks of a multithreaded parse, which are sized by the counting pass and never grow.
+	Parse_Storage *storage;
+
+	// Set by parse_with_callbacks(). Attributes, corners and objects then go to the callbacks and nothing is stored.
+	Parse_Callbacks *callbacks;
+
+	// Bit (1 << keyword) is set for statements that are skipped up to the end of their line without being looked at.
+	// Skipped attributes are still counted, so that face indices stay correct.
+	U32 skipped_statements;
+
+	Vec4F32 *positions;
+	Vec3F32 *tex_coords;
+	Vec3F32 *normals;
+	S64 position_index;
+	S64 tex_coord_index;
+	S64 normal_index;
+	S64 positions_capacity;
+	S64 tex_coords_capacity;
+	S64 normals_capacity;
+
+	U32 smoothing_group; // Of the faces that follow.
+	bool out_of_memory;  // A list couldn't grow. Parsing stops with an error.
+};
+
+// Doubles the capacity of an array that is the last allocation in its arena. Returns NULL and leaves the array and its
+// capacity as they were if the arena's reservation is used up.
+void *grow_array(Arena *arena, void *data, S64 element_size, S64 *capacity) {
+	S64 new_capacity = Max(*capacity * 2, 4096);
+	void *result = arena_try_realloc(arena, data, element_size * *capacity, element_size * new_capacity);
+	if (result) {
+		*capacity = new_capacity;
 	}
+	return result;
+}
 
-	OBJ_Scene *scene = make_scene(arena);
+// Starts a new segment for the object with the given name. An empty name continues the current object.
+void select_object(Parse_State *state, String8 name) {
+	ProfileZone("select_object");
+	if (state->callbacks) {
+		if (state->callbacks->on_object && name.len > 0) {
+			state->callbacks->on_object(state->callbacks->user_data, name);
+		}
+		return;
+	}
+	Parse_Chunk *chunk = state->chunk;
+	if (chunk->segments_count == chunk->segments_capacity) {
+		Assert(state->storage && "Chunks are sized up front and must not grow.");
+		Chunk_Segment *segments = (Chunk_Segment*)grow_array(&state->storage->segments, chunk->segments, sizeof(Chunk_Segment), &chunk->segments_capacity);
+		if (!segments) {
+			state->out_of_memory = true;
+			return;
+		}
+		chunk->segments = segments;
+	}
+	Chunk_Segment *segment = &chunk->segments[chunk->segments_count++];
+	*segment = {};
+	segment->name = name;
+	segment->first_corner = chunk->corners_count;
+}
 
-	Vec4F32 *positions = (Vec4F32*)arena_alloc(arena, sizeof(*positions) * 1024 * 1024);
-	Vec3F32 *tex_coords = (Vec3F32*)arena_alloc(arena, sizeof(*tex_coords) * 1024 * 1024 * 2);
-	Vec3F32 *normals = (Vec3F32*)arena_alloc(arena, sizeof(*normals) * 1024 * 1024 * 2);
+void add_face_corner(Parse_State *state, S64 v_index, S64 vt_index, S64 vn_index) {
+	ProfileZone("add_face_corner");
+	if (state->callbacks) {
+		if (state->callbacks->on_face_corner) {
+			state->callbacks->on_face_corner(state->callbacks->user_data, v_index, vt_index, vn_index);
+		}
+		return;
+	}
+	Parse_Chunk *chunk = state->chunk;
+	if (chunk->corners_count == chunk->corners_capacity) {
+		Assert(state->storage && "Chunks are sized up front and must not grow.");
+		Face_Corner *corners = (Face_Corner*)grow_array(&state->storage->corners, chunk->corners, sizeof(Face_Corner), &chunk->corners_capacity);
+		if (!corners) {
+			state->out_of_memory = true;
+			return;
+		}
+		chunk->corners = corners;
+	}
+	if (chunk->corners_count % 3 == 0 && !(state->skipped_statements & (1u << KIND_KEYWORD_S))) {
+		S64 face = chunk->corners_count / 3;
+		if (face == chunk->smoothing_groups_capacity) {
+			Assert(state->storage && "Chunks are sized up front and must not grow.");
+			U32 *smoothing_groups = (U32*)grow_array(&state->storage->smoothing_groups, chunk->smoothing_groups, sizeof(U32), &chunk->smoothing_groups_capacity);
+			if (!smoothing_groups) {
+				state->out_of_memory = true;
+				return;
+			}
+			chunk->smoothing_groups = smoothing_groups;
+		}
+		chunk->smoothing_groups[face] = state->smoothing_group;
+	}
+	chunk->corners[chunk->corners_count++] = {(U32)v_index, (U32)vt_index, (U32)vn_index};
+}
 
-	// NOTE(Jan): We leave the first element zeroed. Later we calculate the index and use the following lists to access
-	// the correct position, texture coordinate, and normals. This is a neat trick to zero the values for vertices where
-	// the obj file does not specify texture coordinates or normals.
-	// This is also nice because indices in obj files start with 1 anyway, so parsing an index will have the correct
-	// index value directly, without having to subtract one from the parsed value.
-	// The indices may just be defined as 0 and are valid this way.
-	positions[0] = {};
-	tex_coords[0] = {};
-	normals[0] = {};
+// Stores a completed v, vt or vn statement, or hands it to its callback.
+void add_attribute(Parse_State *state, int keyword, F32 *values) {
+	ProfileZone("add_attribute");
+	Parse_Callbacks *callbacks = state->callbacks;
+	if (keyword == KIND_KEYWORD_V) {
+		Vec4F32 position = {values[0], values[1], values[2], values[3]};
+		if (callbacks) {
+			if (callbacks->on_position) {
+				callbacks->on_position(callbacks->user_data, position);
+			}
+		} else {
+			if (state->position_index == state->positions_capacity) {
+				Assert(state->storage && "Chunks are sized up front and must not grow.");
+				Vec4F32 *positions = (Vec4F32*)grow_array(&state->storage->positions, state->positions, sizeof(*state->positions), &state->positions_capacity);
+				if (!positions) {
+					state->out_of_memory = true;
+					return;
+				}
+				state->positions = positions;
+			}
+			state->positions[state->position_index] = position;
+		}
+		state->position_index += 1;
+	} else if (keyword == KIND_KEYWORD_VT) {
+		Vec3F32 tex_coord = {values[0], values[1], values[2]};
+		if (callbacks) {
+			if (callbacks->on_tex_coord) {
+				callbacks->on_tex_coord(callbacks->user_data, tex_coord);
+			}
+		} else {
+			if (state->tex_coord_index == state->tex_coords_capacity) {
+				Assert(state->storage && "Chunks are sized up front and must not grow.");
+				Vec3F32 *tex_coords = (Vec3F32*)grow_array(&state->storage->tex_coords, state->tex_coords, sizeof(*state->tex_coords), &state->tex_coords_capacity);
+				if (!tex_coords) {
+					state->out_of_memory = true;
+					return;
+				}
+				state->tex_coords = tex_coords;
+			}
+			state->tex_coords[state->tex_coord_index] = tex_coord;
+		}
+		state->tex_coord_index += 1;
+	} else if (keyword == KIND_KEYWORD_VN) {
+		Vec3F32 normal = {values[0], values[1], values[2]};
+		if (callbacks) {
+			if (callbacks->on_normal) {
+				callbacks->on_normal(callbacks->user_data, normal);
+			}
+		} else {
+			if (state->normal_index == state->normals_capacity) {
+				Assert(state->storage && "Chunks are sized up front and must not grow.");
+				Vec3F32 *normals = (Vec3F32*)grow_array(&state->storage->normals, state->normals, sizeof(*state->normals), &state->normals_capacity);
+				if (!normals) {
+					state->out_of_memory = true;
+					return;
+				}
+				state->normals = normals;
+			}
+			state->normals[state->normal_index] = normal;
+		}
+		state->normal_index += 1;
+	}
+}
 
-	S64 position_index = 1;
-	S64 tex_coord_index = 1;
-	S64 normal_index = 1;
+// Parses statements until the end of the tokenizer's text or the first error. If the text ends at a statement boundary
+// (as chunks other than the last do) the final statement is completed as if the next keyword had followed.
+bool parse_statements(Parse_State *state, bool end_is_statement_boundary) {
+	Tokenizer *tokenizer = &state->tokenizer;
+	Parse_Chunk *chunk = state->chunk;
 
-	Tokenizer tokenizer = make_tokenizer(file_name, (char *)file.data, file.len);
+	// The corners a chunk starts with belong to the object that is current at its start.
+	select_object(state, {"", 0});
 
 	struct {
-		int low;
-		int high;
+		int low = 0;
+		int high = 0;
 		int kind;
 		int count = 0;
 	} expect;
@@ -407,10 +1158,17 @@ Parse_Result parse(Arena *arena, char *file_name) {
 
 	bool error = false;
 	int curr_keyword = KIND_KEYWORD;
-	OBJ_Object *curr_object = NULL;
+	F32 attribute[4] = {}; // Values of the current v, vt or vn statement.
+
+	Token tok = next_token(tokenizer);
+	while (!error) {
+		if (tok.kind == KIND_END_OF_FILE) {
+			if (!end_is_statement_boundary || expect.kind == KIND_KEYWORD) {
+				break;
+			}
+			// Complete the statement below, then stop.
+		}
 
-	Token tok = next_token(&tokenizer);
-	while (tok.kind != KIND_END_OF_FILE && !error) {
 		bool next = true;
 		if (expect.kind == KIND_KEYWORD && (KIND_KEYWORD_BEGIN < tok.kind && tok.kind < KIND_KEYWORD_END)) {
 			// If a keyword is expected and we got a keyword.
@@ -435,12 +1193,24 @@ Parse_Result parse(Arena *arena, char *file_name) {
 					expect = {3, 3, KIND_PRIMITIVE_ELEMENT};
 					break;
 				}
+				case KIND_KEYWORD_S: {
+					expect = {1, 1, KIND_INTEGER};
+					break;
+				}
 				default: {
 					Assert(0 && "This should not happen.");
 					error = true;
 				}
 			}
 			curr_keyword = tok.kind;
+
+			if (state->skipped_statements & (1u << curr_keyword)) {
+				tokenizer->at = find_end_of_line(tokenizer->at, tokenizer->file.start + tokenizer->file.len);
+				state->position_index += curr_keyword == KIND_KEYWORD_V;
+				state->tex_coord_index += curr_keyword == KIND_KEYWORD_VT;
+				state->normal_index += curr_keyword == KIND_KEYWORD_VN;
+				expect = {1, 1, KIND_KEYWORD};
+			}
 		} else if (expect.kind != KIND_KEYWORD) {
 			// If we didn't expect a keyword.
 			if (tok.kind == expect.kind) {
@@ -448,43 +1218,14 @@ Parse_Result parse(Arena *arena, char *file_name) {
 				switch (tok.kind) {
 					case KIND_NAME: {
 						if (curr_keyword == KIND_KEYWORD_O) {
-							// TODO(Jan): 02/02/2025
-							// Depending on the name we need to select the correct object or group. To do this, hashing the
-							// name would be a good idea. However, the amount of objects and groups is relatively small in
-							// most obj files. Therefore, linear search and string_compare are likely enough. If the
-							// performance of the approach is too bad, we should switch to a hash.
-							OBJ_Object *object = scene->objects_last;
-							bool found = false;
-							if (object) {
-								do {
-									if (0 == string_compare(object->name, tok.value)) {
-										found = true;
-										break;
-									}
-									object = object->prev;
-								} while (object != NULL);
-							}
-
-							if (object == NULL || !found) {
-								object = make_object(arena);
-								object->name = tok.value;
-								object->vertices = (OBJ_Vertex*)arena_alloc(arena, sizeof(OBJ_Vertex) * 1024LL * 1024LL);
-								object->indices = (OBJ_Index*)arena_alloc(arena, sizeof(OBJ_Index) * 1024LL * 1024LL);
-								append_object(scene, object);
-							}
-
-							curr_object = object;
+							select_object(state, tok.value);
 						}
 						break;
 					}
 
 					case KIND_FLOAT: {
-						if (curr_keyword == KIND_KEYWORD_V) {
-							positions[position_index].v[expect.count] = string_to_float(tok.value.start, (int)tok.value.len);
-						} else if (curr_keyword == KIND_KEYWORD_VT) {
-							tex_coords[tex_coord_index].v[expect.count] = string_to_float(tok.value.start, (int)tok.value.len);
-						} else if (curr_keyword == KIND_KEYWORD_VN) {
-							normals[normal_index].v[expect.count] = string_to_float(tok.value.start, (int)tok.value.len);
+						if (curr_keyword == KIND_KEYWORD_V || curr_keyword == KIND_KEYWORD_VT || curr_keyword == KIND_KEYWORD_VN) {
+							attribute[expect.count] = tok.float_value;
 						} else {
 							Assert(0 && "Unhandled.");
 							error = true;
@@ -493,57 +1234,37 @@ Parse_Result parse(Arena *arena, char *file_name) {
 					}
 
 					case KIND_INTEGER: {
+						if (curr_keyword == KIND_KEYWORD_S) {
+							// Digits only, or "off". Groups past the reserved values all end up in the last one.
+							U64 group = 0;
+							for (size_t i = 0; i < tok.value.len && is_digit(tok.value.start[i]); i += 1) {
+								group = Min(group * 10 + (tok.value.start[i] - '0'), (U64)SMOOTHING_GROUP_INHERITED - 1);
+							}
+							state->smoothing_group = (U32)group;
+						}
 						break;
 					}
 
 					case KIND_PRIMITIVE_ELEMENT: {
-						int first_slash = -1;
-						int second_slash = -1;
-						int i = 0;
-						while (i < tok.value.len) {
-							if (first_slash == -1 && tok.value.start[i] == '/') {
-								first_slash = i;
-							} else if (first_slash != -1 && tok.value.start[i] == '/') {
-								second_slash = i;
-								break;
-							}
-							i += 1;
-						}
-
-						int pe_v_index = 0;
-						int pe_vt_index = 0;
-						int pe_vn_index = 0;
-
-						if (first_slash == -1) {
-							// int
-							pe_v_index = string_to_int(tok.value.start, (int)tok.value.len);
-						} else if (first_slash != -1 && second_slash == -1) {
-							// int/int
-							pe_v_index = string_to_int(tok.value.start, first_slash);
-							pe_vt_index = string_to_int(tok.value.start + first_slash + 1, (int)tok.value.len - first_slash - 1);
-						} else if (first_slash != -1 && second_slash != -1 && first_slash + 1 == second_slash) {
-							// int//int
-							pe_v_index = string_to_int(tok.value.start, first_slash);
-							pe_vn_index = string_to_int(tok.value.start + second_slash + 1, (int)tok.value.len - second_slash - 1);
-						} else {
-							// int/int/int
-							pe_v_index = string_to_int(tok.value.start, first_slash);
-							pe_vt_index = string_to_int(tok.value.start + first_slash + 1, second_slash - first_slash - 1);
-							pe_vn_index = string_to_int(tok.value.start + second_slash + 1, (int)tok.value.len - second_slash - 1);
-						}
+						// Negative indices are relative to the end of the respective list, -1 being the last element.
+						S64 pe_v_index = tok.element[0] < 0 ? state->position_index + tok.element[0] : tok.element[0];
+						S64 pe_vt_index = tok.element[1] < 0 ? state->tex_coord_index + tok.element[1] : tok.element[1];
+						S64 pe_vn_index = tok.element[2] < 0 ? state->normal_index + tok.element[2] : tok.element[2];
 
 						if (pe_v_index == 0) {
-							printf("%s (%lld): Invalid vertex index in face element.", tokenizer.file_name, tokenizer.line_number);
+							report_error(tokenizer, "Invalid vertex index in face element.\n");
+							error = true;
+							break;
+						}
+						if (pe_v_index < 0 || pe_v_index >= state->position_index ||
+						    pe_vt_index < 0 || pe_vt_index >= state->tex_coord_index ||
+						    pe_vn_index < 0 || pe_vn_index >= state->normal_index) {
+							report_error(tokenizer, "Face element refers to an undefined vertex: %.*s\n", (int)tok.value.len, tok.value.start);
 							error = true;
+							break;
 						}
 
-						// TODO(Jan): 02/02/2025
-						// Maybe make the vertex array growable?
-						// TODO(Jan): Vertices are not yet correctly inserted. If a primitive element is exactly the
-						// same as another one, we don't insert a new vertex. Instead, we look it up and use this index
-						// in the index array. If it doesn't exist we insert it and use the new index.
-						OBJ_Vertex vertex = {positions[pe_v_index], tex_coords[pe_vt_index], normals[pe_vn_index]};
-						curr_object->vertices[curr_object->vertices_count++] = vertex;
+						add_face_corner(state, pe_v_index, pe_vt_index, pe_vn_index);
 						break;
 					}
 					default: {
@@ -560,34 +1281,2400 @@ Parse_Result parse(Arena *arena, char *file_name) {
 
 					// When the v keyword is followed by only 3 floats the 4th value (w) must be assigned 1.
 					if (expect.count < expect.high && curr_keyword == KIND_KEYWORD_V) {
-						positions[position_index].v[3] = 1.0f;
+						attribute[3] = 1.0f;
+					}
+					// A vt without its optional third value gets 0.
+					if (expect.count < expect.high && curr_keyword == KIND_KEYWORD_VT) {
+						attribute[2] = 0.0f;
 					}
 
 					expect = {1, 1, KIND_KEYWORD};
 
-					position_index += curr_keyword == KIND_KEYWORD_V;
-					tex_coord_index += curr_keyword == KIND_KEYWORD_VT;
-					normal_index += curr_keyword == KIND_KEYWORD_VN;
+					add_attribute(state, curr_keyword, attribute);
 				} else {
 					// We didn't get a keyword and didn't get what we expected and the count is not within expectations. Error.
-					printf("%s (%lld): syntax error: Expected a %s. Got: %s\n", 
-					       tokenizer.file_name, tokenizer.line_number, token_kind_to_string[expect.kind], token_kind_to_string[tok.kind]);
+					report_error(tokenizer, "syntax error: Expected a %s. Got: %s\n", token_kind_to_string[expect.kind], token_kind_to_string[tok.kind]);
 					error = true;
 				}
 			}
 		} else {
 			// We didn't get what we expected. Error.
-			printf("%s (%lld): syntax error: Expected a %s. Got: %s\n", 
-			       tokenizer.file_name, tokenizer.line_number, token_kind_to_string[expect.kind], token_kind_to_string[tok.kind]);
+			report_error(tokenizer, "syntax error: Expected a %s. Got: %s\n", token_kind_to_string[expect.kind], token_kind_to_string[tok.kind]);
 			error = true;
 		}
 
 		if (next) {
+			if (tok.kind == KIND_END_OF_FILE) {
+				break;
+			}
 			// print_token(tok);
-			tok = next_token(&tokenizer);
+			tok = next_token(tokenizer);
 		}
 		error = error || tok.kind == KIND_NONE;
+		if (state->out_of_memory) {
+			report_error(tokenizer, "out of memory: The file has more elements than the parse can hold.\n");
+			error = true;
+		}
+	}
+
+	for (S64 i = 0; chunk && i < chunk->segments_count; i += 1) {
+		Chunk_Segment *segment = &chunk->segments[i];
+		S64 end = (i + 1 < chunk->segments_count) ? chunk->segments[i + 1].first_corner : chunk->corners_count;
+		segment->corners_count = end - segment->first_corner;
+	}
+	if (chunk) {
+		chunk->last_smoothing_group = state->smoothing_group;
+		chunk->end_line = tokenizer->line_number;
+		chunk->success = !error;
+	}
+
+	return !error;
+}
+
+// Allocates the attribute lists with room for count elements after the zeroed first one.
+void make_attribute_lists(Arena *positions_arena, Arena *tex_coords_arena, Arena *normals_arena, Parse_State *state,
+                          S64 positions_count, S64 tex_coords_count, S64 normals_count) {
+	state->positions_capacity = positions_count + 1;
+	state->tex_coords_capacity = tex_coords_count + 1;
+	state->normals_capacity = normals_count + 1;
+	state->positions = (Vec4F32*)arena_alloc(positions_arena, sizeof(*state->positions) * state->positions_capacity);
+	state->tex_coords = (Vec3F32*)arena_alloc(tex_coords_arena, sizeof(*state->tex_coords) * state->tex_coords_capacity);
+	state->normals = (Vec3F32*)arena_alloc(normals_arena, sizeof(*state->normals) * state->normals_capacity);
+
+	// NOTE(Jan): We leave the first element zeroed. Later we calculate the index and use the following lists to access
+	// the correct position, texture coordinate, and normals. This is a neat trick to zero the values for vertices where
+	// the obj file does not specify texture coordinates or normals.
+	// This is also nice because indices in obj files start with 1 anyway, so parsing an index will have the correct
+	// index value directly, without having to subtract one from the parsed value.
+	// The indices may just be defined as 0 and are valid this way.
+	state->positions[0] = {};
+	state->tex_coords[0] = {};
+	state->normals[0] = {};
+
+	state->position_index = 1;
+	state->tex_coord_index = 1;
+	state->normal_index = 1;
+}
+
+//
+// Building objects from the parsed chunks.
+
+typedef struct Vertex_Cache_Buffers Vertex_Cache_Buffers;
+struct Vertex_Cache_Buffers {
+	U32 *adjacency_offsets; // Per vertex, the start of its triangles in adjacency.
+	U32 *live_triangles;    // Per vertex, how many of its triangles aren't emitted yet. They come first.
+	U32 *adjacency;
+	S32 *cache_positions;
+	F32 *vertex_scores;
+	F32 *triangle_scores;
+	U8 *triangles_emitted;
+	OBJ_Index *indices;
+	Face_Corner *corners;
+	Vec4F32 *tangents; // Only with tangents.
+};
+
+typedef struct Tangent_Buffers Tangent_Buffers;
+struct Tangent_Buffers {
+	Vec4F32 *corner_tangents; // Per corner, its face's tangent in the plane of the normal, times the corner's angle.
+	                          // w is the sign of the bitangent.
+	U32 *corner_offsets;      // Per vertex, the start of its corners in corners. One more than vertices.
+	U32 *corners;
+};
+
+typedef struct Object_Build Object_Build;
+struct Object_Build {
+	OBJ_Object *object;
+	Chunk_Segment *segments_first;
+	Chunk_Segment *segments_last;
+	S64 corners_count;
+
+	// Distinct corners in order of first use. Each becomes one vertex.
+	Face_Corner *unique_corners;
+
+	// With 16 bit indices the index buffer is built here and narrowed once its width is known. Splitting writes the
+	// corners of each submesh to split_corners.
+	OBJ_Index *indices;
+	Face_Corner *split_corners;
+	Vec4F32 *split_tangents;
+	OBJ_Submesh *submeshes;
+	S64 submeshes_count;
+
+	// Working memory of optimize_vertex_cache(), sized once the vertices are known.
+	Vertex_Cache_Buffers cache_buffers;
+
+	// Per unique corner with tangents, and the working memory of generate_object_tangents(). Vertices split by it are
+	// added to the unique corners.
+	Vec4F32 *tangents;
+	Tangent_Buffers tangent_buffers;
+
+	// Meshlets are built into buffers sized for the worst case, then copied into the scene.
+	OBJ_Meshlet *meshlets;
+	S64 meshlets_count;
+	U32 *meshlet_vertices;
+	S64 meshlet_vertices_count;
+	U8 *meshlet_triangles;
+	S64 meshlet_triangles_count;
+	U8 *meshlet_slots; // Per vertex, where it is in the current meshlet.
+
+	bool missing_normals; // Some of its corners have no normal, see generate_normals().
+};
+
+// What the non-templated parts of the parser need to know about a vertex layout.
+typedef struct Vertex_Layout_Info Vertex_Layout_Info;
+struct Vertex_Layout_Info {
+	U32 layout;
+	U32 vertex_size;
+	U32 attributes;
+	U32 skipped_statements;
+	Thread_Task_Proc *deduplicate_object;
+	Thread_Task_Proc *gather_object_vertices;
+	Thread_Task_Proc *gather_object_streams;
+};
+
+typedef struct Scene_Build Scene_Build;
+struct Scene_Build {
+	Arena *arena;
+	Arena *temp;
+	OBJ_Scene *scene;
+	Object_Build *objects;
+	S64 objects_count;
+	S64 *object_of_entry; // Index into objects for each entry of the scene's name table.
+	Parse_State *state; // Holds the attribute lists.
+	Vertex_Layout_Info *layout;
+	bool streams; // PARSE_FLAG_SOA
+	bool compact_indices; // PARSE_FLAG_16BIT_INDICES
+	bool split_indices; // PARSE_FLAG_SPLIT_INDICES
+	bool optimize_vertex_cache; // PARSE_FLAG_OPTIMIZE_VERTEX_CACHE
+	bool meshlets; // PARSE_FLAG_MESHLETS
+	bool generate_normals; // PARSE_FLAG_GENERATE_NORMALS or PARSE_FLAG_ANGLE_WEIGHTED_NORMALS
+	bool angle_weighted_normals; // PARSE_FLAG_ANGLE_WEIGHTED_NORMALS
+	bool tangents; // PARSE_FLAG_TANGENTS, if the layout has normals and texture coordinates
+};
+
+// Returns the index of the object with the given name, creating it the first time the name shows up.
+S64 select_object_build(Scene_Build *build, String8 name) {
+	ProfileZone("select_object_build");
+	OBJ_Name_Table *names = &build->scene->names;
+	U64 hash = hash_ascii(name.start, name.len);
+	OBJ_Name_Entry *entry = lookup_name(names, name, hash);
+	S64 *object_index = &build->object_of_entry[entry - names->entries];
+	if (!entry->object) {
+		OBJ_Object *object = make_object(build->arena);
+		insert_name(build->arena, names, entry, name, hash, object);
+		object->name = entry->name;
+		append_object(build->scene, object);
+
+		Object_Build *object_build = &build->objects[build->objects_count];
+		*object_build = {};
+		object_build->object = object;
+		*object_index = build->objects_count++;
+	}
+	return *object_index;
+}
+
+// Assigns the segments of all chunks to objects in file order. An 'o' selects the object with that name, creating it
+// the first time the name shows up. Faces before the first 'o' go to an object without a name.
+void stitch_segments(Scene_Build *build, Parse_Chunk *chunks, S64 chunks_count) {
+	ProfileTraceZone("stitch_segments");
+	S64 max_objects = 0;
+	for (S64 i = 0; i < chunks_count; i += 1) {
+		max_objects += chunks[i].segments_count;
+	}
+	build->objects = (Object_Build*)arena_alloc(build->temp, sizeof(Object_Build) * max_objects);
+	make_name_table(build->arena, &build->scene->names, max_objects);
+	build->object_of_entry = (S64*)arena_alloc(build->temp, sizeof(S64) * (build->scene->names.mask + 1));
+
+	S64 curr_object = -1;
+	for (S64 i = 0; i < chunks_count; i += 1) {
+		Parse_Chunk *chunk = &chunks[i];
+		for (S64 j = 0; j < chunk->segments_count; j += 1) {
+			Chunk_Segment *segment = &chunk->segments[j];
+			if (j > 0) {
+				curr_object = select_object_build(build, segment->name);
+			} else if (curr_object == -1 && segment->corners_count > 0) {
+				curr_object = select_object_build(build, {"", 0});
+			}
+
+			if (curr_object != -1 && segment->corners_count > 0) {
+				Object_Build *object = &build->objects[curr_object];
+				segment->corners = chunk->corners + segment->first_corner;
+				segment->smoothing_groups = chunk->smoothing_groups ? chunk->smoothing_groups + segment->first_corner / 3 : NULL;
+				if (object->segments_last) {
+					object->segments_last->next_in_object = segment;
+				} else {
+					object->segments_first = segment;
+				}
+				object->segments_last = segment;
+				object->corners_count += segment->corners_count;
+			}
+		}
+	}
+}
+
+U32 hash_face_corner(Face_Corner corner) {
+	U64 h = ((U64)corner.v * 0x9E3779B97F4A7C15ULL) ^ ((U64)corner.vt * 0xC2B2AE3D27D4EB4FULL) ^ ((U64)corner.vn * 0x165667B19E3779F9ULL);
+	h ^= h >> 29;
+	h *= 0xBF58476D1CE4E5B9ULL;
+	h ^= h >> 32;
+	return (U32)h;
+}
+
+// Cuts the triangles of an object into runs that each use at most OBJ_INDEX16_MAX_VERTICES vertices. Vertices used by
+// more than one submesh are duplicated. Rewrites the indices to be relative to their submesh.
+void split_object(Object_Build *object_build) {
+	OBJ_Object *object = object_build->object;
+	OBJ_Index *indices = object_build->indices;
+
+	// The deduplication table is done with and has room for one U32 per corner.
+	U32 *remap = (U32*)((U8*)object_build->unique_corners + sizeof(Face_Corner) * object_build->corners_count);
+
+	// remap[vertex] - 1 is where the vertex went. It's in the current submesh if that is at or after its start.
+	MemoryZero(remap, sizeof(U32) * object->vertices_count);
+	OBJ_Submesh *submesh = NULL;
+	S64 vertices_count = 0;
+	for (S64 i = 0; i < object->indices_count; i += 3) {
+		S64 missing = 0;
+		for (S64 j = 0; j < 3; j += 1) {
+			OBJ_Index index = indices[i + j];
+			bool repeated = (j > 0 && indices[i] == index) || (j > 1 && indices[i + 1] == index);
+			if (!repeated && (!submesh || (S64)remap[index] <= submesh->first_vertex)) {
+				missing += 1;
+			}
+		}
+		if (!submesh || submesh->vertices_count + missing > OBJ_INDEX16_MAX_VERTICES) {
+			submesh = &object_build->submeshes[object_build->submeshes_count++];
+			*submesh = {i, 0, vertices_count, 0};
+		}
+		for (S64 j = 0; j < 3; j += 1) {
+			OBJ_Index index = indices[i + j];
+			if ((S64)remap[index] <= submesh->first_vertex) {
+				object_build->split_corners[vertices_count] = object_build->unique_corners[index];
+				if (object_build->tangents) {
+					object_build->split_tangents[vertices_count] = object_build->tangents[index];
+				}
+				vertices_count += 1;
+				remap[index] = (U32)vertices_count;
+				submesh->vertices_count += 1;
+			}
+			indices[i + j] = (OBJ_Index)(remap[index] - 1 - submesh->first_vertex);
+		}
+		submesh->indices_count += 3;
+	}
+	object_build->unique_corners = object_build->split_corners;
+	object_build->tangents = object_build->split_tangents;
+	object->vertices_count = vertices_count;
+}
+
+//
+// Vertex cache optimization, after Tom Forsyth's "Linear-Speed Vertex Cache Optimisation". Triangles are emitted
+// greedily by score: vertices score higher the more recently they were used in an LRU cache of
+// VERTEX_CACHE_SIZE entries, and the fewer triangles they have left, so that vertices get finished off. Only the
+// triangles of vertices in the cache are rescored after each step, which keeps it linear in the number of triangles.
+//
+#define VERTEX_CACHE_SIZE 32
+#define VERTEX_CACHE_VALENCE_TABLE_SIZE 64
+
+void allocate_vertex_cache_buffers(Arena *arena, Object_Build *object_build) {
+	S64 vertices_count = object_build->object->vertices_count;
+	S64 corners_count = object_build->object->indices_count;
+	Vertex_Cache_Buffers *buffers = &object_build->cache_buffers;
+	buffers->adjacency_offsets = (U32*)arena_alloc(arena, sizeof(U32) * vertices_count);
+	buffers->live_triangles = (U32*)arena_alloc(arena, sizeof(U32) * vertices_count);
+	buffers->adjacency = (U32*)arena_alloc(arena, sizeof(U32) * corners_count);
+	buffers->cache_positions = (S32*)arena_alloc(arena, sizeof(S32) * vertices_count);
+	buffers->vertex_scores = (F32*)arena_alloc(arena, sizeof(F32) * vertices_count);
+	buffers->triangle_scores = (F32*)arena_alloc(arena, sizeof(F32) * (corners_count / 3));
+	buffers->triangles_emitted = (U8*)arena_alloc(arena, corners_count / 3);
+	buffers->indices = (OBJ_Index*)arena_alloc(arena, sizeof(OBJ_Index) * corners_count);
+	buffers->corners = (Face_Corner*)arena_alloc(arena, sizeof(Face_Corner) * vertices_count);
+	if (object_build->tangents) {
+		buffers->tangents = (Vec4F32*)arena_alloc(arena, sizeof(Vec4F32) * vertices_count);
+	}
+}
+
+F32 get_vertex_cache_score(S32 cache_position, U32 live_triangles, F32 *cache_table, F32 *valence_table) {
+	if (live_triangles == 0) {
+		return -1.0f; // Nothing left to draw with it.
+	}
+	F32 score = (cache_position < 0) ? 0.0f : cache_table[cache_position];
+	score += (live_triangles < VERTEX_CACHE_VALENCE_TABLE_SIZE) ? valence_table[live_triangles] : 2.0f / sqrtf((F32)live_triangles);
+	return score;
+}
+
+// Reorders the triangles of an object for the post-transform vertex cache, then its vertices into the order the
+// triangles first use them, for the pre-transform fetch.
+void optimize_vertex_cache(Object_Build *object_build) {
+	OBJ_Object *object = object_build->object;
+	Vertex_Cache_Buffers *buffers = &object_build->cache_buffers;
+	S64 vertices_count = object->vertices_count;
+	S64 triangles_count = object->indices_count / 3;
+	OBJ_Index *indices = object->indices;
+	if (triangles_count == 0) {
+		return;
+	}
+
+	// The three most recent vertices belong to the last triangle, so they score the same whatever order they were
+	// added in.
+	F32 cache_table[VERTEX_CACHE_SIZE];
+	for (S32 i = 0; i < VERTEX_CACHE_SIZE; i += 1) {
+		cache_table[i] = (i < 3) ? 0.75f : powf(1.0f - (F32)(i - 3) / (F32)(VERTEX_CACHE_SIZE - 3), 1.5f);
+	}
+	F32 valence_table[VERTEX_CACHE_VALENCE_TABLE_SIZE];
+	valence_table[0] = 0.0f;
+	for (S32 i = 1; i < VERTEX_CACHE_VALENCE_TABLE_SIZE; i += 1) {
+		valence_table[i] = 2.0f / sqrtf((F32)i);
+	}
+
+	MemoryZero(buffers->live_triangles, sizeof(U32) * vertices_count);
+	for (S64 i = 0; i < triangles_count * 3; i += 1) {
+		buffers->live_triangles[indices[i]] += 1;
+	}
+	U32 offset = 0;
+	for (S64 i = 0; i < vertices_count; i += 1) {
+		buffers->adjacency_offsets[i] = offset;
+		offset += buffers->live_triangles[i];
+		buffers->live_triangles[i] = 0;
+	}
+	for (S64 i = 0; i < triangles_count * 3; i += 1) {
+		OBJ_Index vertex = indices[i];
+		buffers->adjacency[buffers->adjacency_offsets[vertex] + buffers->live_triangles[vertex]++] = (U32)(i / 3);
+	}
+	for (S64 i = 0; i < vertices_count; i += 1) {
+		buffers->cache_positions[i] = -1;
+		buffers->vertex_scores[i] = get_vertex_cache_score(-1, buffers->live_triangles[i], cache_table, valence_table);
+	}
+	S64 best_triangle = 0;
+	F32 best_score = -1.0f;
+	for (S64 i = 0; i < triangles_count; i += 1) {
+		F32 score = buffers->vertex_scores[indices[i * 3 + 0]] + buffers->vertex_scores[indices[i * 3 + 1]] +
+		            buffers->vertex_scores[indices[i * 3 + 2]];
+		buffers->triangle_scores[i] = score;
+		buffers->triangles_emitted[i] = 0;
+		if (score > best_score) {
+			best_score = score;
+			best_triangle = i;
+		}
+	}
+
+	// The cache holds three entries more than its size, for the vertices the newest triangle pushes out.
+	U32 cache[VERTEX_CACHE_SIZE + 3];
+	U32 new_cache[VERTEX_CACHE_SIZE + 3];
+	S32 cache_count = 0;
+	S64 next_unemitted = 0;
+	for (S64 emitted = 0; emitted < triangles_count; emitted += 1) {
+		if (best_triangle < 0) {
+			// A dead end: nothing in the cache has triangles left, so take the next one in the original order.
+			while (buffers->triangles_emitted[next_unemitted]) {
+				next_unemitted += 1;
+			}
+			best_triangle = next_unemitted;
+		}
+		OBJ_Index *triangle = &indices[best_triangle * 3];
+		MemoryCopy(&buffers->indices[emitted * 3], triangle, sizeof(OBJ_Index) * 3);
+		buffers->triangles_emitted[best_triangle] = 1;
+
+		S32 new_cache_count = 0;
+		for (S32 i = 0; i < 3; i += 1) {
+			OBJ_Index vertex = triangle[i];
+			// Move the triangle behind the live ones of the vertex. A repeated vertex has already moved it.
+			U32 *adjacency = &buffers->adjacency[buffers->adjacency_offsets[vertex]];
+			for (U32 j = 0; j < buffers->live_triangles[vertex]; j += 1) {
+				if (adjacency[j] == (U32)best_triangle) {
+					buffers->live_triangles[vertex] -= 1;
+					adjacency[j] = adjacency[buffers->live_triangles[vertex]];
+					adjacency[buffers->live_triangles[vertex]] = (U32)best_triangle;
+					break;
+				}
+			}
+			if (buffers->cache_positions[vertex] != -2) {
+				buffers->cache_positions[vertex] = -2; // Marks it as already in the new cache.
+				new_cache[new_cache_count++] = vertex;
+			}
+		}
+		for (S32 i = 0; i < cache_count; i += 1) {
+			if (buffers->cache_positions[cache[i]] != -2) {
+				new_cache[new_cache_count++] = cache[i];
+			}
+		}
+
+		// Rescore the vertices and then the triangles that are, or just were, in the cache.
+		for (S32 i = 0; i < new_cache_count; i += 1) {
+			U32 vertex = new_cache[i];
+			S32 position = (i < VERTEX_CACHE_SIZE) ? i : -1;
+			buffers->cache_positions[vertex] = position;
+			buffers->vertex_scores[vertex] = get_vertex_cache_score(position, buffers->live_triangles[vertex], cache_table, valence_table);
+		}
+		best_triangle = -1;
+		best_score = -1.0f;
+		for (S32 i = 0; i < new_cache_count; i += 1) {
+			U32 vertex = new_cache[i];
+			U32 *adjacency = &buffers->adjacency[buffers->adjacency_offsets[vertex]];
+			for (U32 j = 0; j < buffers->live_triangles[vertex]; j += 1) {
+				OBJ_Index *other = &indices[adjacency[j] * 3];
+				F32 score = buffers->vertex_scores[other[0]] + buffers->vertex_scores[other[1]] + buffers->vertex_scores[other[2]];
+				buffers->triangle_scores[adjacency[j]] = score;
+				if (score > best_score && i < VERTEX_CACHE_SIZE) {
+					best_score = score;
+					best_triangle = adjacency[j];
+				}
+			}
+		}
+
+		cache_count = Min(new_cache_count, VERTEX_CACHE_SIZE);
+		MemoryCopy(cache, new_cache, sizeof(U32) * cache_count);
+	}
+
+	// Renumber the vertices in order of first use. live_triangles is free again and becomes the map from old to new.
+	U32 *remap = buffers->live_triangles;
+	MemorySet(remap, 0xff, sizeof(U32) * vertices_count);
+	U32 next_vertex = 0;
+	for (S64 i = 0; i < triangles_count * 3; i += 1) {
+		OBJ_Index vertex = buffers->indices[i];
+		if (remap[vertex] == 0xffffffff) {
+			buffers->corners[next_vertex] = object_build->unique_corners[vertex];
+			if (object_build->tangents) {
+				buffers->tangents[next_vertex] = object_build->tangents[vertex];
+			}
+			remap[vertex] = next_vertex++;
+		}
+		indices[i] = remap[vertex];
+	}
+	MemoryCopy(object_build->unique_corners, buffers->corners, sizeof(Face_Corner) * next_vertex);
+	if (object_build->tangents) {
+		MemoryCopy(object_build->tangents, buffers->tangents, sizeof(Vec4F32) * next_vertex);
+	}
+}
+
+// Runs between deduplication and gathering, once an object's vertices are known.
+void prepare_object_indices(void *data, S64 object_index) {
+	ProfileTraceZone("prepare_object_indices");
+	Scene_Build *build = (Scene_Build*)data;
+	Object_Build *object_build = &build->objects[object_index];
+	if (build->optimize_vertex_cache) {
+		optimize_vertex_cache(object_build);
+	}
+	if (build->split_indices && object_build->object->vertices_count > OBJ_INDEX16_MAX_VERTICES) {
+		split_object(object_build);
+	}
+}
+
+//
+// Meshlets. Triangles are added to the current meshlet in index order until one would exceed its limits, so
+// PARSE_FLAG_OPTIMIZE_VERTEX_CACHE makes them tighter.
+//
+
+// A meshlet closes with more than OBJ_MESHLET_MAX_VERTICES - 3 vertices or with OBJ_MESHLET_MAX_TRIANGLES triangles,
+// so each one but the last holds at least this many triangles. A lower bound: at least MAX_VERTICES - 2 vertices, at
+// most 3 new ones per triangle, and ceil((MAX_VERTICES - 2) / 3) is MAX_VERTICES / 3.
+#define MESHLET_MIN_TRIANGLES (OBJ_MESHLET_MAX_VERTICES / 3)
+
+void allocate_meshlet_buffers(Arena *arena, Object_Build *object_build) {
+	S64 triangles_count = object_build->object->indices_count / 3;
+	S64 max_meshlets = triangles_count / MESHLET_MIN_TRIANGLES + 1;
+	object_build->meshlets = (OBJ_Meshlet*)arena_alloc(arena, sizeof(OBJ_Meshlet) * max_meshlets);
+	object_build->meshlet_vertices = (U32*)arena_alloc(arena, sizeof(U32) * Min(max_meshlets * OBJ_MESHLET_MAX_VERTICES, triangles_count * 3));
+	object_build->meshlet_triangles = (U8*)arena_alloc(arena, triangles_count * 3);
+	object_build->meshlet_slots = (U8*)arena_alloc(arena, object_build->object->vertices_count);
+}
+
+Vec3F32 get_object_position(Parse_State *state, Object_Build *object_build, U32 vertex) {
+	Vec4F32 position = state->positions[object_build->unique_corners[vertex].v];
+	return {position.x, position.y, position.z};
+}
+
+// Bounding sphere around the center of the bounds, and the normal cone of the triangles.
+void finish_meshlet(Parse_State *state, Object_Build *object_build, OBJ_Meshlet *meshlet) {
+	U32 *vertices = &object_build->meshlet_vertices[meshlet->vertex_offset];
+	U8 *triangles = &object_build->meshlet_triangles[meshlet->triangle_offset * 3];
+
+	Vec3F32 min = get_object_position(state, object_build, vertices[0]);
+	Vec3F32 max = min;
+	for (U32 i = 1; i < meshlet->vertices_count; i += 1) {
+		Vec3F32 position = get_object_position(state, object_build, vertices[i]);
+		min.x = Min(min.x, position.x); max.x = Max(max.x, position.x);
+		min.y = Min(min.y, position.y); max.y = Max(max.y, position.y);
+		min.z = Min(min.z, position.z); max.z = Max(max.z, position.z);
+	}
+	meshlet->center = (min + max) * 0.5f;
+	meshlet->radius = 0.0f;
+	for (U32 i = 0; i < meshlet->vertices_count; i += 1) {
+		Vec3F32 position = get_object_position(state, object_build, vertices[i]);
+		meshlet->radius = Max(meshlet->radius, len_3f32(position - meshlet->center));
+	}
+
+	// The axis is the average of the triangle normals. The cone has to contain all of them.
+	Vec3F32 normals[OBJ_MESHLET_MAX_TRIANGLES];
+	Vec3F32 first_positions[OBJ_MESHLET_MAX_TRIANGLES];
+	U32 normals_count = 0;
+	Vec3F32 normal_sum = {};
+	for (U32 i = 0; i < meshlet->triangles_count; i += 1) {
+		Vec3F32 a = get_object_position(state, object_build, vertices[triangles[i * 3 + 0]]);
+		Vec3F32 b = get_object_position(state, object_build, vertices[triangles[i * 3 + 1]]);
+		Vec3F32 c = get_object_position(state, object_build, vertices[triangles[i * 3 + 2]]);
+		Vec3F32 normal = cross_3f32(b - a, c - a);
+		F32 area = len_3f32(normal);
+		if (area == 0.0f) {
+			continue; // Degenerate triangles face nowhere.
+		}
+		normals[normals_count] = normal * (1.0f / area);
+		first_positions[normals_count] = a;
+		normal_sum = normal_sum + normals[normals_count];
+		normals_count += 1;
+	}
+	meshlet->cone_apex = meshlet->center;
+	meshlet->cone_axis = {0.0f, 0.0f, 0.0f};
+	meshlet->cone_cutoff = 1.0f;
+	F32 axis_length = len_3f32(normal_sum);
+	if (normals_count == 0 || axis_length == 0.0f) {
+		return;
+	}
+	Vec3F32 axis = normal_sum * (1.0f / axis_length);
+	meshlet->cone_axis = axis;
+
+	F32 min_dot = 1.0f;
+	for (U32 i = 0; i < normals_count; i += 1) {
+		min_dot = Min(min_dot, dot_3f32(normals[i], axis));
+	}
+	if (min_dot <= 0.1f) {
+		return; // Wider than about 84 degrees, the cone would hardly ever cull anything.
+	}
+
+	// Move the apex back along the axis until every triangle's plane is in front of it.
+	F32 max_t = 0.0f;
+	for (U32 i = 0; i < normals_count; i += 1) {
+		F32 t = dot_3f32(meshlet->center - first_positions[i], normals[i]) / dot_3f32(axis, normals[i]);
+		max_t = Max(max_t, t);
+	}
+	meshlet->cone_apex = meshlet->center - axis * max_t;
+	meshlet->cone_cutoff = sqrtf(1.0f - min_dot * min_dot);
+}
+
+void build_object_meshlets(void *data, S64 object_index) {
+	ProfileTraceZone("build_object_meshlets");
+	Scene_Build *build = (Scene_Build*)data;
+	Object_Build *object_build = &build->objects[object_index];
+	OBJ_Object *object = object_build->object;
+	U8 *slots = object_build->meshlet_slots;
+	MemorySet(slots, 0xff, object->vertices_count);
+
+	OBJ_Submesh whole = {0, object->indices_count, 0, object->vertices_count};
+	OBJ_Submesh *submeshes = object_build->submeshes_count ? object_build->submeshes : &whole;
+	S64 submeshes_count = object_build->submeshes_count ? object_build->submeshes_count : 1;
+
+	OBJ_Meshlet *meshlet = NULL;
+	for (S64 s = 0; s < submeshes_count; s += 1) {
+		OBJ_Submesh *submesh = &submeshes[s];
+		for (S64 i = submesh->first_index; i < submesh->first_index + submesh->indices_count; i += 3) {
+			U32 triangle[3];
+			U32 missing = 0;
+			for (S64 j = 0; j < 3; j += 1) {
+				triangle[j] = (U32)(object->indices[i + j] + submesh->first_vertex);
+				bool repeated = (j > 0 && triangle[0] == triangle[j]) || (j > 1 && triangle[1] == triangle[j]);
+				missing += (!repeated && slots[triangle[j]] == 0xff);
+			}
+			if (meshlet && (meshlet->vertices_count + missing > OBJ_MESHLET_MAX_VERTICES ||
+			                meshlet->triangles_count == OBJ_MESHLET_MAX_TRIANGLES)) {
+				finish_meshlet(build->state, object_build, meshlet);
+				for (U32 j = 0; j < meshlet->vertices_count; j += 1) {
+					slots[object_build->meshlet_vertices[meshlet->vertex_offset + j]] = 0xff;
+				}
+				meshlet = NULL;
+			}
+			if (!meshlet) {
+				meshlet = &object_build->meshlets[object_build->meshlets_count++];
+				*meshlet = {};
+				meshlet->vertex_offset = (U32)object_build->meshlet_vertices_count;
+				meshlet->triangle_offset = (U32)object_build->meshlet_triangles_count;
+			}
+			for (S64 j = 0; j < 3; j += 1) {
+				if (slots[triangle[j]] == 0xff) {
+					slots[triangle[j]] = (U8)meshlet->vertices_count++;
+					object_build->meshlet_vertices[object_build->meshlet_vertices_count++] = triangle[j];
+				}
+				object_build->meshlet_triangles[object_build->meshlet_triangles_count * 3 + j] = slots[triangle[j]];
+			}
+			object_build->meshlet_triangles_count += 1;
+			meshlet->triangles_count += 1;
+		}
+	}
+	if (meshlet) {
+		finish_meshlet(build->state, object_build, meshlet);
+	}
+}
+
+// Replaces each corner by the index of the first equal corner, using an open addressing table with linear probing that
+// is at most half full. Slots hold the unique corner index + 1; 0 is empty. Attributes the vertex layout doesn't contain
+// are ignored, so corners that only differ in them share a vertex.
+template <typename Vertex>
+void deduplicate_object(void *data, S64 object_index) {
+	ProfileTraceZone("deduplicate_object");
+	Scene_Build *build = (Scene_Build*)data;
+	Object_Build *object_build = &build->objects[object_index];
+	OBJ_Object *object = object_build->object;
+
+	U32 *table = (U32*)((U8*)object_build->unique_corners + sizeof(Face_Corner) * object_build->corners_count);
+	U64 table_size = (U64)next_power_of(2, object_build->corners_count * 2);
+	U64 table_mask = table_size - 1;
+	MemoryZero(table, sizeof(U32) * table_size);
+
+	S64 unique_count = 0;
+	for (Chunk_Segment *segment = object_build->segments_first; segment; segment = segment->next_in_object) {
+		for (S64 i = 0; i < segment->corners_count; i += 1) {
+			Face_Corner corner = segment->corners[i];
+			corner.vt = (Vertex::attributes & OBJ_VERTEX_TEX_COORD) ? corner.vt : 0;
+			corner.vn = (Vertex::attributes & OBJ_VERTEX_NORMAL) ? corner.vn : 0;
+			U64 slot = hash_face_corner(corner) & table_mask;
+			for (;;) {
+				U32 entry = table[slot];
+				if (entry == 0) {
+					object_build->unique_corners[unique_count] = corner;
+					table[slot] = (U32)(unique_count + 1);
+					object->indices[object->indices_count++] = (OBJ_Index)unique_count;
+					unique_count += 1;
+					break;
+				}
+				Face_Corner other = object_build->unique_corners[entry - 1];
+				if (other.v == corner.v && other.vt == corner.vt && other.vn == corner.vn) {
+					object->indices[object->indices_count++] = (OBJ_Index)(entry - 1);
+					break;
+				}
+				slot = (slot + 1) & table_mask;
+			}
+		}
+	}
+	object->vertices_count = unique_count;
+}
+
+// Maps the bounds of the positions onto the unorm16 range.
+OBJ_Quantization get_position_quantization(Parse_State *state, Face_Corner *corners, S64 corners_count) {
+	OBJ_Quantization quantization = {};
+	if (corners_count == 0) {
+		return quantization;
+	}
+	Vec4F32 first = state->positions[corners[0].v];
+	Vec3F32 min = {first.x, first.y, first.z};
+	Vec3F32 max = min;
+	for (S64 i = 1; i < corners_count; i += 1) {
+		Vec4F32 position = state->positions[corners[i].v];
+		min.x = Min(min.x, position.x); max.x = Max(max.x, position.x);
+		min.y = Min(min.y, position.y); max.y = Max(max.y, position.y);
+		min.z = Min(min.z, position.z); max.z = Max(max.z, position.z);
+	}
+	quantization.position_offset = min;
+	quantization.position_scale = (max - min) * (1.0f / 65535.0f);
+	return quantization;
+}
+
+// Accumulates the bounds of an object while its positions are written. The box stays in SSE registers. The sphere
+// grows incrementally, as in Ritter's algorithm, and is replaced by the box's circumsphere if that ends up tighter.
+typedef struct Bounds_Accumulator Bounds_Accumulator;
+struct Bounds_Accumulator {
+#if defined(SIMD_AVX512) || defined(SIMD_AVX2) || defined(SIMD_SSE2)
+	__m128 min;
+	__m128 max;
+#else
+	Vec3F32 min;
+	Vec3F32 max;
+#endif
+	Vec3F32 center;
+	F32 radius;
+	S64 count;
+};
+
+void accumulate_bounds(Bounds_Accumulator *bounds, Vec4F32 *position) {
+	Vec3F32 p = {position->x, position->y, position->z};
+#if defined(SIMD_AVX512) || defined(SIMD_AVX2) || defined(SIMD_SSE2)
+	__m128 v = _mm_loadu_ps(position->v);
+	if (bounds->count == 0) {
+		bounds->min = bounds->max = v;
+	}
+	bounds->min = _mm_min_ps(bounds->min, v);
+	bounds->max = _mm_max_ps(bounds->max, v);
+#else
+	if (bounds->count == 0) {
+		bounds->min = bounds->max = p;
+	}
+	bounds->min.x = Min(bounds->min.x, p.x); bounds->max.x = Max(bounds->max.x, p.x);
+	bounds->min.y = Min(bounds->min.y, p.y); bounds->max.y = Max(bounds->max.y, p.y);
+	bounds->min.z = Min(bounds->min.z, p.z); bounds->max.z = Max(bounds->max.z, p.z);
+#endif
+
+	if (bounds->count == 0) {
+		bounds->center = p;
+	}
+	Vec3F32 offset = p - bounds->center;
+	F32 distance_squared = dot_3f32(offset, offset);
+	if (distance_squared > bounds->radius * bounds->radius) {
+		// Grow just enough to touch the point, moving the center towards it.
+		F32 distance = sqrtf(distance_squared);
+		F32 radius = (bounds->radius + distance) * 0.5f;
+		bounds->center = bounds->center + offset * ((radius - bounds->radius) / distance);
+		bounds->radius = radius;
+	}
+	bounds->count += 1;
+}
+
+OBJ_Bounds finish_bounds(Bounds_Accumulator *bounds) {
+	OBJ_Bounds result = {};
+	if (bounds->count == 0) {
+		return result;
+	}
+#if defined(SIMD_AVX512) || defined(SIMD_AVX2) || defined(SIMD_SSE2)
+	F32 min[4], max[4];
+	_mm_storeu_ps(min, bounds->min);
+	_mm_storeu_ps(max, bounds->max);
+	result.min = {min[0], min[1], min[2]};
+	result.max = {max[0], max[1], max[2]};
+#else
+	result.min = bounds->min;
+	result.max = bounds->max;
+#endif
+	result.center = bounds->center;
+	result.radius = bounds->radius;
+	F32 box_radius = 0.5f * len_3f32(result.max - result.min);
+	if (box_radius < result.radius) {
+		result.center = (result.min + result.max) * 0.5f;
+		result.radius = box_radius;
+	}
+	return result;
+}
+
+// The smallest sphere around both.
+void merge_bounds(OBJ_Bounds *bounds, OBJ_Bounds *other, bool first) {
+	if (first) {
+		*bounds = *other;
+		return;
+	}
+	bounds->min.x = Min(bounds->min.x, other->min.x); bounds->max.x = Max(bounds->max.x, other->max.x);
+	bounds->min.y = Min(bounds->min.y, other->min.y); bounds->max.y = Max(bounds->max.y, other->max.y);
+	bounds->min.z = Min(bounds->min.z, other->min.z); bounds->max.z = Max(bounds->max.z, other->max.z);
+
+	Vec3F32 offset = other->center - bounds->center;
+	F32 distance = len_3f32(offset);
+	if (distance + other->radius <= bounds->radius) {
+		return;
+	}
+	if (distance + bounds->radius <= other->radius) {
+		bounds->center = other->center;
+		bounds->radius = other->radius;
+		return;
+	}
+	F32 radius = (distance + bounds->radius + other->radius) * 0.5f;
+	bounds->center = bounds->center + offset * ((radius - bounds->radius) / distance);
+	bounds->radius = radius;
+}
+
+void update_scene_bounds(OBJ_Scene *scene) {
+	bool first = true;
+	scene->bounds = {};
+	for (OBJ_Object *object = scene->objects_first; object; object = object->next) {
+		if (object->vertices_count > 0) {
+			merge_bounds(&scene->bounds, &object->bounds, first);
+			first = false;
+		}
+	}
+}
+
+template <typename Vertex>
+void gather_object_vertices(void *data, S64 object_index) {
+	ProfileTraceZone("gather_object_vertices");
+	Scene_Build *build = (Scene_Build*)data;
+	Object_Build *object_build = &build->objects[object_index];
+	OBJ_Object *object = object_build->object;
+	Parse_State *state = build->state;
+
+	if (Vertex::attributes & OBJ_VERTEX_QUANTIZED) {
+		object->quantization = get_position_quantization(state, object_build->unique_corners, object->vertices_count);
+	}
+
+	Bounds_Accumulator bounds = {};
+	Vertex *vertices = (Vertex*)object->vertex_data;
+	for (S64 i = 0; i < object->vertices_count; i += 1) {
+		Face_Corner corner = object_build->unique_corners[i];
+		accumulate_bounds(&bounds, &state->positions[corner.v]);
+		vertices[i] = Vertex::make(state->positions[corner.v], state->tex_coords[corner.vt], state->normals[corner.vn],
+		                           &object->quantization);
+	}
+	object->bounds = finish_bounds(&bounds);
+}
+
+template <typename Vertex>
+void gather_object_streams(void *data, S64 object_index) {
+	ProfileTraceZone("gather_object_streams");
+	Scene_Build *build = (Scene_Build*)data;
+	Object_Build *object_build = &build->objects[object_index];
+	OBJ_Object *object = object_build->object;
+	OBJ_Vertex_Streams *streams = &object->streams;
+	Parse_State *state = build->state;
+
+	Bounds_Accumulator bounds = {};
+	for (S64 i = 0; i < streams->padded_count; i += 1) {
+		Face_Corner corner = object_build->unique_corners[Min(i, object->vertices_count - 1)];
+		Vec4F32 position = state->positions[corner.v];
+		if (i < object->vertices_count) {
+			accumulate_bounds(&bounds, &position);
+		}
+		streams->x[i] = position.x;
+		streams->y[i] = position.y;
+		streams->z[i] = position.z;
+		if (Vertex::attributes & OBJ_VERTEX_POSITION_W) {
+			streams->w[i] = position.w;
+		}
+		if (Vertex::attributes & OBJ_VERTEX_NORMAL) {
+			Vec3F32 normal = state->normals[corner.vn];
+			streams->nx[i] = normal.x;
+			streams->ny[i] = normal.y;
+			streams->nz[i] = normal.z;
+		}
+		if (Vertex::attributes & OBJ_VERTEX_TEX_COORD) {
+			Vec3F32 tex_coord = state->tex_coords[corner.vt];
+			streams->u[i] = tex_coord.x;
+			streams->v[i] = tex_coord.y;
+			if (Vertex::attributes & OBJ_VERTEX_TEX_COORD_W) {
+				streams->t[i] = tex_coord.z;
+			}
+		}
+	}
+	object->bounds = finish_bounds(&bounds);
+}
+
+template <typename Vertex>
+Vertex_Layout_Info get_vertex_layout_info(void) {
+	Vertex_Layout_Info info;
+	info.layout = Vertex::layout;
+	info.vertex_size = sizeof(Vertex);
+	info.attributes = Vertex::attributes;
+	info.skipped_statements = ((Vertex::attributes & OBJ_VERTEX_TEX_COORD) ? 0 : (1u << KIND_KEYWORD_VT)) |
+	                          ((Vertex::attributes & OBJ_VERTEX_NORMAL) ? 0 : (1u << KIND_KEYWORD_VN)) |
+	                          (1u << KIND_KEYWORD_S);
+	info.deduplicate_object = deduplicate_object<Vertex>;
+	info.gather_object_vertices = gather_object_vertices<Vertex>;
+	info.gather_object_streams = gather_object_streams<Vertex>;
+	return info;
+}
+
+// Moves the indices out of the temporary buffer, narrowing them where the object allows it.
+void store_object_indices(void *data, S64 object_index) {
+	ProfileTraceZone("store_object_indices");
+	Scene_Build *build = (Scene_Build*)data;
+	Object_Build *object_build = &build->objects[object_index];
+	OBJ_Object *object = object_build->object;
+
+	if (object->index_size == sizeof(U16)) {
+		for (S64 i = 0; i < object->indices_count; i += 1) {
+			object->indices_u16[i] = (U16)object_build->indices[i];
+		}
+	} else {
+		MemoryCopy(object->indices, object_build->indices, sizeof(OBJ_Index) * object->indices_count);
+	}
+}
+
+// Allocates the streams of the object's vertices in one block.
+void allocate_vertex_streams(Arena *arena, OBJ_Object *object, U32 attributes) {
+	OBJ_Vertex_Streams *streams = &object->streams;
+	*streams = {};
+	streams->padded_count = get_aligned_size(object->vertices_count, OBJ_VERTEX_STREAM_WIDTH);
+
+	F32 **used[10];
+	S64 used_count = 0;
+	used[used_count++] = &streams->x;
+	used[used_count++] = &streams->y;
+	used[used_count++] = &streams->z;
+	if (attributes & OBJ_VERTEX_POSITION_W) {
+		used[used_count++] = &streams->w;
+	}
+	if (attributes & OBJ_VERTEX_NORMAL) {
+		used[used_count++] = &streams->nx;
+		used[used_count++] = &streams->ny;
+		used[used_count++] = &streams->nz;
+	}
+	if (attributes & OBJ_VERTEX_TEX_COORD) {
+		used[used_count++] = &streams->u;
+		used[used_count++] = &streams->v;
+	}
+	if (attributes & OBJ_VERTEX_TEX_COORD_W) {
+		used[used_count++] = &streams->t;
+	}
+
+	// The padded count keeps every stream a multiple of 64 bytes long, so all of them stay aligned.
+	F32 *block = (F32*)arena_alloc(arena, sizeof(F32) * streams->padded_count * used_count, 64);
+	for (S64 i = 0; i < used_count; i += 1) {
+		*used[i] = block + streams->padded_count * i;
+	}
+}
+
+//
+// Normal generation
+//
+// Faces without normals in the file get smooth ones. The normal of a corner is the weighted sum of the normals of the
+// faces around its position that are in the same smoothing group and bend away from its face by at most
+// OBJ_NORMAL_CREASE_ANGLE degrees. Faces with 's off' keep their own normal.
+//
+// This runs on the corners before deduplication: every corner gets the index of a generated normal, and corners at the
+// same position with the same normal share it. Deduplication then merges the corners that are smooth across faces and
+// keeps apart the ones on either side of a crease. The generated normals follow those of the file in the normal list.
+//
+// Objects are prepared in parallel, then the faces of all objects are processed in parallel in ranges of
+// NORMAL_FACES_PER_TASK.
+#ifndef OBJ_NORMAL_CREASE_ANGLE
+#define OBJ_NORMAL_CREASE_ANGLE 60.0f
+#endif
+#define NORMAL_FACES_PER_TASK 16384
+
+typedef struct Normal_Object Normal_Object;
+struct Normal_Object {
+	Object_Build *object_build;
+	Chunk_Segment segment; // All corners of the object in one run, which replaces its segments.
+	S64 faces_count;
+	U32 first_normal; // The normal generated for corner i is state->normals[first_normal + i].
+
+	Vec3F32 *face_normals;   // Unit length, zero for degenerate faces.
+	F32 *corner_weights;     // How much the normal of the corner's face counts at the corner's position.
+	U32 *corner_positions;   // Per corner, the index of its position among those the object uses.
+	U32 *position_offsets;   // Per position, the start of its corners in position_corners. One more than positions.
+	U32 *position_corners;   // The corners of every position, in order.
+	U32 *table;              // Maps positions of the file to those of the object, like the table of deduplicate_object().
+};
+
+typedef struct Normal_Task Normal_Task;
+struct Normal_Task {
+	Normal_Object *object;
+	S64 first_face;
+	S64 faces_count;
+};
+
+typedef struct Normal_Generation Normal_Generation;
+struct Normal_Generation {
+	Scene_Build *build;
+	Normal_Object *objects;
+	S64 objects_count;
+	Normal_Task *tasks;
+	S64 tasks_count;
+	F32 crease_cosine;
+};
+
+// Smoothing groups are only read when normals are generated, and normals are only generated for layouts that have them.
+bool generates_normals(Vertex_Layout_Info *layout, U32 flags) {
+	return (flags & (PARSE_FLAG_GENERATE_NORMALS | PARSE_FLAG_ANGLE_WEIGHTED_NORMALS)) && (layout->attributes & OBJ_VERTEX_NORMAL);
+}
+
+U32 get_skipped_statements(Vertex_Layout_Info *layout, U32 flags) {
+	U32 skipped = layout->skipped_statements;
+	if (generates_normals(layout, flags)) {
+		skipped &= ~(1u << KIND_KEYWORD_S);
+	}
+	return skipped;
+}
+
+// Gives the faces at the start of each chunk the group that was current where the previous chunk ended.
+void resolve_smoothing_groups(Parse_Chunk *chunks, S64 chunks_count) {
+	for (S64 i = 1; i < chunks_count; i += 1) {
+		Parse_Chunk *chunk = &chunks[i];
+		U32 inherited = chunks[i - 1].last_smoothing_group;
+		for (S64 face = 0; face < chunk->corners_count / 3 && chunk->smoothing_groups[face] == SMOOTHING_GROUP_INHERITED; face += 1) {
+			chunk->smoothing_groups[face] = inherited;
+		}
+		if (chunk->last_smoothing_group == SMOOTHING_GROUP_INHERITED) {
+			chunk->last_smoothing_group = inherited;
+		}
+	}
+}
+
+void find_missing_normals(void *data, S64 object_index) {
+	Scene_Build *build = (Scene_Build*)data;
+	Object_Build *object_build = &build->objects[object_index];
+	object_build->missing_normals = false;
+	for (Chunk_Segment *segment = object_build->segments_first; segment && !object_build->missing_normals; segment = segment->next_in_object) {
+		for (S64 i = 0; i < segment->corners_count; i += 1) {
+			if (segment->corners[i].vn == 0) {
+				object_build->missing_normals = true;
+				break;
+			}
+		}
+	}
+}
+
+// Gathers the corners of the object into one run and finds the corners around every position.
+void prepare_normal_object(void *data, S64 object_index) {
+	Normal_Generation *generation = (Normal_Generation*)data;
+	Normal_Object *normal_object = &generation->objects[object_index];
+	Object_Build *object_build = normal_object->object_build;
+	Chunk_Segment *segment = &normal_object->segment;
+
+	S64 corners_count = 0;
+	for (Chunk_Segment *other = object_build->segments_first; other; other = other->next_in_object) {
+		MemoryCopy(segment->corners + corners_count, other->corners, sizeof(Face_Corner) * other->corners_count);
+		MemoryCopy(segment->smoothing_groups + corners_count / 3, other->smoothing_groups, sizeof(U32) * (other->corners_count / 3));
+		corners_count += other->corners_count;
+	}
+	object_build->segments_first = segment;
+	object_build->segments_last = segment;
+
+	// Counting sort of the corners by position.
+	U64 table_mask = (U64)next_power_of(2, corners_count * 2) - 1;
+	MemoryZero(normal_object->table, sizeof(U32) * (table_mask + 1));
+	MemoryZero(normal_object->position_offsets, sizeof(U32) * (corners_count + 1));
+	U32 positions_count = 0;
+	for (S64 i = 0; i < corners_count; i += 1) {
+		U32 v = segment->corners[i].v;
+		U64 slot = hash_face_corner({v, 0, 0}) & table_mask;
+		U32 position;
+		for (;;) {
+			U32 entry = normal_object->table[slot];
+			if (entry == 0) {
+				// Until the corners are sorted, position_corners holds the first corner of every position.
+				position = positions_count++;
+				normal_object->table[slot] = position + 1;
+				normal_object->position_corners[position] = (U32)i;
+				break;
+			}
+			if (segment->corners[normal_object->position_corners[entry - 1]].v == v) {
+				position = entry - 1;
+				break;
+			}
+			slot = (slot + 1) & table_mask;
+		}
+		normal_object->corner_positions[i] = position;
+		normal_object->position_offsets[position + 1] += 1;
+	}
+	for (U32 i = 0; i < positions_count; i += 1) {
+		normal_object->position_offsets[i + 1] += normal_object->position_offsets[i];
+	}
+	for (S64 i = 0; i < corners_count; i += 1) {
+		U32 *offset = &normal_object->position_offsets[normal_object->corner_positions[i]];
+		normal_object->position_corners[(*offset)++] = (U32)i;
+	}
+	// Each offset was moved to the end of its position, which is the start of the next one.
+	for (U32 i = positions_count; i > 0; i -= 1) {
+		normal_object->position_offsets[i] = normal_object->position_offsets[i - 1];
+	}
+	normal_object->position_offsets[0] = 0;
+}
+
+Vec3F32 get_corner_position(Parse_State *state, Face_Corner *corner) {
+	Vec4F32 position = state->positions[corner->v];
+	return {position.x, position.y, position.z};
+}
+
+// The weight of a face at one of its corners is its area, or the angle between its edges there. The length of the cross
+// product is twice the area at every corner, so the angle is atan2(length, dot of the edges).
+void compute_face_normal(Normal_Generation *generation, Normal_Object *normal_object, S64 face) {
+	Face_Corner *corners = normal_object->segment.corners + face * 3;
+	Vec3F32 p[3];
+	for (S32 k = 0; k < 3; k += 1) {
+		p[k] = get_corner_position(generation->build->state, &corners[k]);
+	}
+	Vec3F32 normal = cross_3f32(p[1] - p[0], p[2] - p[0]);
+	F32 length = len_3f32(normal);
+	normal_object->face_normals[face] = (length > 0.0f) ? normal * (1.0f / length) : Vec3F32{};
+	for (S32 k = 0; k < 3; k += 1) {
+		F32 *weight = &normal_object->corner_weights[face * 3 + k];
+		if (generation->build->angle_weighted_normals) {
+			*weight = atan2_f32(length, dot_3f32(p[(k + 1) % 3] - p[k], p[(k + 2) % 3] - p[k]));
+		} else {
+			*weight = length;
+		}
+	}
+}
+
+void compute_face_normals(void *data, S64 task_index) {
+	Normal_Generation *generation = (Normal_Generation*)data;
+	Normal_Task *task = &generation->tasks[task_index];
+	Normal_Object *normal_object = task->object;
+	S64 face = task->first_face;
+	S64 end = task->first_face + task->faces_count;
+#if defined(SIMD_AVX512) || defined(SIMD_AVX2) || defined(SIMD_SSE2)
+	// Four faces at a time, one per lane.
+	Vec4F32 *positions = generation->build->state->positions;
+	__m128 zero = _mm_setzero_ps();
+	for (; face + 4 <= end; face += 4) {
+		Face_Corner *corners = normal_object->segment.corners + face * 3;
+		__m128 p[3][3];
+		for (S32 k = 0; k < 3; k += 1) {
+			for (S32 axis = 0; axis < 3; axis += 1) {
+				p[k][axis] = _mm_setr_ps(positions[corners[k].v].v[axis], positions[corners[3 + k].v].v[axis],
+				                         positions[corners[6 + k].v].v[axis], positions[corners[9 + k].v].v[axis]);
+			}
+		}
+		// Edges leaving each corner, towards the next and the previous corner.
+		__m128 next[3][3], previous[3][3];
+		for (S32 k = 0; k < 3; k += 1) {
+			for (S32 axis = 0; axis < 3; axis += 1) {
+				next[k][axis] = _mm_sub_ps(p[(k + 1) % 3][axis], p[k][axis]);
+				previous[k][axis] = _mm_sub_ps(p[(k + 2) % 3][axis], p[k][axis]);
+			}
+		}
+		__m128 normal[3];
+		normal[0] = _mm_sub_ps(_mm_mul_ps(next[0][1], previous[0][2]), _mm_mul_ps(next[0][2], previous[0][1]));
+		normal[1] = _mm_sub_ps(_mm_mul_ps(next[0][2], previous[0][0]), _mm_mul_ps(next[0][0], previous[0][2]));
+		normal[2] = _mm_sub_ps(_mm_mul_ps(next[0][0], previous[0][1]), _mm_mul_ps(next[0][1], previous[0][0]));
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(normal[0], normal[0]), _mm_mul_ps(normal[1], normal[1])), _mm_mul_ps(normal[2], normal[2])));
+		__m128 inverse_length = _mm_and_ps(_mm_cmpgt_ps(length, zero), _mm_div_ps(_mm_set1_ps(1.0f), length));
+
+		F32 normal_out[3][4], length_out[4];
+		for (S32 axis = 0; axis < 3; axis += 1) {
+			_mm_storeu_ps(normal_out[axis], _mm_mul_ps(normal[axis], inverse_length));
+		}
+		_mm_storeu_ps(length_out, length);
+		for (S32 j = 0; j < 4; j += 1) {
+			normal_object->face_normals[face + j] = {normal_out[0][j], normal_out[1][j], normal_out[2][j]};
+		}
+
+		F32 *weights = normal_object->corner_weights + face * 3;
+		if (generation->build->angle_weighted_normals) {
+			for (S32 k = 0; k < 3; k += 1) {
+				__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(next[k][0], previous[k][0]), _mm_mul_ps(next[k][1], previous[k][1])), _mm_mul_ps(next[k][2], previous[k][2]));
+				F32 dot_out[4];
+				_mm_storeu_ps(dot_out, dot);
+				for (S32 j = 0; j < 4; j += 1) {
+					weights[j * 3 + k] = atan2_f32(length_out[j], dot_out[j]);
+				}
+			}
+		} else {
+			for (S32 j = 0; j < 4; j += 1) {
+				weights[j * 3 + 0] = weights[j * 3 + 1] = weights[j * 3 + 2] = length_out[j];
+			}
+		}
+	}
+#endif
+	for (; face < end; face += 1) {
+		compute_face_normal(generation, normal_object, face);
+	}
+}
+
+void compute_corner_normals(void *data, S64 task_index) {
+	Normal_Generation *generation = (Normal_Generation*)data;
+	Normal_Task *task = &generation->tasks[task_index];
+	Normal_Object *normal_object = task->object;
+	Face_Corner *corners = normal_object->segment.corners;
+	U32 *smoothing_groups = normal_object->segment.smoothing_groups;
+	Vec3F32 *face_normals = normal_object->face_normals;
+	Vec3F32 *normals = generation->build->state->normals;
+
+	for (S64 face = task->first_face; face < task->first_face + task->faces_count; face += 1) {
+		Vec3F32 face_normal = face_normals[face];
+		U32 group = smoothing_groups[face];
+		for (S64 i = face * 3; i < face * 3 + 3; i += 1) {
+			// Corners with a normal in the file keep it. It is copied so that generated normals can be compared to it.
+			Vec3F32 *normal = &normals[normal_object->first_normal + i];
+			if (corners[i].vn != 0) {
+				*normal = normals[corners[i].vn];
+				continue;
+			}
+			Vec3F32 sum = {};
+			U32 position = normal_object->corner_positions[i];
+			for (U32 j = normal_object->position_offsets[position]; j < normal_object->position_offsets[position + 1]; j += 1) {
+				U32 other = normal_object->position_corners[j];
+				S64 other_face = other / 3;
+				if (other_face != face) {
+					if (group == SMOOTHING_GROUP_OFF || smoothing_groups[other_face] != group ||
+					    dot_3f32(face_normal, face_normals[other_face]) < generation->crease_cosine) {
+						continue;
+					}
+				}
+				sum = sum + face_normals[other_face] * normal_object->corner_weights[other];
+			}
+			F32 length = len_3f32(sum);
+			*normal = (length > 0.0f) ? sum * (1.0f / length) : face_normal;
+		}
+	}
+}
+
+// Points every corner without a normal at the first corner of its position that got the same one.
+void assign_corner_normals(void *data, S64 task_index) {
+	Normal_Generation *generation = (Normal_Generation*)data;
+	Normal_Task *task = &generation->tasks[task_index];
+	Normal_Object *normal_object = task->object;
+	Face_Corner *corners = normal_object->segment.corners;
+	Vec3F32 *normals = generation->build->state->normals + normal_object->first_normal;
+
+	for (S64 i = task->first_face * 3; i < (task->first_face + task->faces_count) * 3; i += 1) {
+		if (corners[i].vn != 0) {
+			continue;
+		}
+		Vec3F32 normal = normals[i];
+		U32 position = normal_object->corner_positions[i];
+		for (U32 j = normal_object->position_offsets[position]; j < normal_object->position_offsets[position + 1]; j += 1) {
+			U32 other = normal_object->position_corners[j];
+			if (normals[other].x == normal.x && normals[other].y == normal.y && normals[other].z == normal.z) {
+				corners[i].vn = normal_object->first_normal + other;
+				break;
+			}
+		}
+	}
+}
+
+// Generates the normals of all objects that have corners without one. Allocates everything up front, since allocation
+// isn't thread safe.
+void generate_normals(Scene_Build *build, Thread_Pool *pool) {
+	ProfileTraceZone("generate_normals");
+	thread_pool_run(pool, build->objects_count, find_missing_normals, build);
+
+	Normal_Generation generation = {};
+	generation.build = build;
+	generation.crease_cosine = cos_f32(OBJ_NORMAL_CREASE_ANGLE / 360.0f);
+	S64 corners_count = 0;
+	for (S64 i = 0; i < build->objects_count; i += 1) {
+		Object_Build *object_build = &build->objects[i];
+		if (object_build->missing_normals) {
+			generation.objects_count += 1;
+			generation.tasks_count += (object_build->corners_count / 3 + NORMAL_FACES_PER_TASK - 1) / NORMAL_FACES_PER_TASK;
+			corners_count += object_build->corners_count;
+		}
+	}
+	if (generation.objects_count == 0) {
+		return;
+	}
+
+	// Every corner gets a slot for its normal after those of the file.
+	Parse_State *state = build->state;
+	Assert(state->normal_index + corners_count <= U32_MAX);
+	Vec3F32 *normals = (Vec3F32*)arena_alloc(build->temp, sizeof(Vec3F32) * (state->normal_index + corners_count));
+	MemoryCopy(normals, state->normals, sizeof(Vec3F32) * state->normal_index);
+	state->normals = normals;
+	state->normals_capacity = state->normal_index + corners_count;
+
+	generation.objects = (Normal_Object*)arena_alloc(build->temp, sizeof(Normal_Object) * generation.objects_count);
+	generation.tasks = (Normal_Task*)arena_alloc(build->temp, sizeof(Normal_Task) * generation.tasks_count);
+	S64 object_index = 0;
+	S64 task_index = 0;
+	S64 first_normal = state->normal_index;
+	for (S64 i = 0; i < build->objects_count; i += 1) {
+		Object_Build *object_build = &build->objects[i];
+		if (!object_build->missing_normals) {
+			continue;
+		}
+		Normal_Object *normal_object = &generation.objects[object_index++];
+		*normal_object = {};
+		S64 count = object_build->corners_count;
+		normal_object->object_build = object_build;
+		normal_object->segment.corners = (Face_Corner*)arena_alloc(build->temp, sizeof(Face_Corner) * count);
+		normal_object->segment.corners_count = count;
+		normal_object->segment.smoothing_groups = (U32*)arena_alloc(build->temp, sizeof(U32) * (count / 3));
+		normal_object->faces_count = count / 3;
+		normal_object->first_normal = (U32)first_normal;
+		normal_object->face_normals = (Vec3F32*)arena_alloc(build->temp, sizeof(Vec3F32) * normal_object->faces_count);
+		normal_object->corner_weights = (F32*)arena_alloc(build->temp, sizeof(F32) * count);
+		normal_object->corner_positions = (U32*)arena_alloc(build->temp, sizeof(U32) * count);
+		normal_object->position_offsets = (U32*)arena_alloc(build->temp, sizeof(U32) * (count + 1));
+		normal_object->position_corners = (U32*)arena_alloc(build->temp, sizeof(U32) * count);
+		normal_object->table = (U32*)arena_alloc(build->temp, sizeof(U32) * next_power_of(2, count * 2));
+		first_normal += count;
+
+		for (S64 face = 0; face < normal_object->faces_count; face += NORMAL_FACES_PER_TASK) {
+			generation.tasks[task_index++] = {normal_object, face, Min(normal_object->faces_count - face, (S64)NORMAL_FACES_PER_TASK)};
+		}
+	}
+
+	thread_pool_run(pool, generation.objects_count, prepare_normal_object, &generation);
+	thread_pool_run(pool, generation.tasks_count, compute_face_normals, &generation);
+	thread_pool_run(pool, generation.tasks_count, compute_corner_normals, &generation);
+	thread_pool_run(pool, generation.tasks_count, assign_corner_normals, &generation);
+}
+
+//
+// Tangents
+//
+// Tangent frames for normal mapping, with the conventions of MikkTSpace: a face's tangent points towards increasing u
+// and is projected into the plane of each vertex normal, the faces around a vertex are weighted by their angle there,
+// and the bitangent is w * cross(normal, tangent).
+//
+// This runs after deduplication. The corners of a vertex are split into separate vertices only where their frames
+// disagree: where the texture is mirrored, so that w differs, or where their tangents point more than 90 degrees apart.
+// Everything happens in one task per object, in index order, so the result doesn't depend on the thread count.
+#define TANGENT_MAX_SPLITS 8
+
+void allocate_tangent_buffers(Arena *arena, Object_Build *object_build) {
+	// Every split adds a vertex for a corner that had one already, so there are never more vertices than corners.
+	S64 corners_count = object_build->corners_count;
+	Tangent_Buffers *buffers = &object_build->tangent_buffers;
+	object_build->tangents = (Vec4F32*)arena_alloc(arena, sizeof(Vec4F32) * corners_count);
+	buffers->corner_tangents = (Vec4F32*)arena_alloc(arena, sizeof(Vec4F32) * corners_count);
+	buffers->corner_offsets = (U32*)arena_alloc(arena, sizeof(U32) * (corners_count + 1));
+	buffers->corners = (U32*)arena_alloc(arena, sizeof(U32) * corners_count);
+}
+
+// Any unit vector in the plane of the normal, for vertices whose faces don't define a tangent.
+Vec3F32 get_fallback_tangent(Vec3F32 normal) {
+	Vec3F32 axis = (Abs(normal.x) < 0.9f) ? Vec3F32{1.0f, 0.0f, 0.0f} : Vec3F32{0.0f, 1.0f, 0.0f};
+	Vec3F32 tangent = axis - normal * dot_3f32(normal, axis);
+	F32 length = len_3f32(tangent);
+	return (length > 0.0f) ? tangent * (1.0f / length) : axis;
+}
+
+void generate_object_tangents(void *data, S64 object_index) {
+	ProfileTraceZone("generate_object_tangents");
+	Scene_Build *build = (Scene_Build*)data;
+	Object_Build *object_build = &build->objects[object_index];
+	OBJ_Object *object = object_build->object;
+	Tangent_Buffers *buffers = &object_build->tangent_buffers;
+	Parse_State *state = build->state;
+	OBJ_Index *indices = object->indices;
+
+	for (S64 i = 0; i < object->indices_count; i += 3) {
+		Vec3F32 p[3];
+		Vec3F32 uv[3];
+		for (S32 k = 0; k < 3; k += 1) {
+			Face_Corner *corner = &object_build->unique_corners[indices[i + k]];
+			p[k] = get_corner_position(state, corner);
+			uv[k] = state->tex_coords[corner->vt];
+		}
+		Vec3F32 edge1 = p[1] - p[0];
+		Vec3F32 edge2 = p[2] - p[0];
+		F32 du1 = uv[1].x - uv[0].x, dv1 = uv[1].y - uv[0].y;
+		F32 du2 = uv[2].x - uv[0].x, dv2 = uv[2].y - uv[0].y;
+		F32 uv_area = du1 * dv2 - du2 * dv1; // Twice the signed area in texture space.
+		F32 inverse_area = (uv_area != 0.0f) ? 1.0f / uv_area : 0.0f;
+		Vec3F32 tangent = (edge1 * dv2 - edge2 * dv1) * inverse_area;
+		Vec3F32 bitangent = (edge2 * du1 - edge1 * du2) * inverse_area;
+
+		for (S32 k = 0; k < 3; k += 1) {
+			Vec3F32 normal = state->normals[object_build->unique_corners[indices[i + k]].vn];
+			Vec3F32 projected = tangent - normal * dot_3f32(normal, tangent);
+			F32 length = len_3f32(projected);
+			Vec3F32 next = p[(k + 1) % 3] - p[k];
+			Vec3F32 previous = p[(k + 2) % 3] - p[k];
+			F32 angle = atan2_f32(len_3f32(cross_3f32(next, previous)), dot_3f32(next, previous));
+			F32 weight = (length > 0.0f) ? angle / length : 0.0f;
+			F32 sign = (dot_3f32(cross_3f32(normal, projected), bitangent) < 0.0f) ? -1.0f : 1.0f;
+			buffers->corner_tangents[i + k] = {projected.x * weight, projected.y * weight, projected.z * weight, sign};
+		}
+	}
+
+	// The corners of every vertex, in index order.
+	S64 vertices_count = object->vertices_count;
+	MemoryZero(buffers->corner_offsets, sizeof(U32) * (vertices_count + 1));
+	for (S64 i = 0; i < object->indices_count; i += 1) {
+		buffers->corner_offsets[indices[i] + 1] += 1;
+	}
+	for (S64 i = 0; i < vertices_count; i += 1) {
+		buffers->corner_offsets[i + 1] += buffers->corner_offsets[i];
+	}
+	for (S64 i = 0; i < object->indices_count; i += 1) {
+		buffers->corners[buffers->corner_offsets[indices[i]]++] = (U32)i;
+	}
+	for (S64 i = vertices_count; i > 0; i -= 1) {
+		buffers->corner_offsets[i] = buffers->corner_offsets[i - 1];
+	}
+	buffers->corner_offsets[0] = 0;
+
+	// A corner joins the first frame of its vertex that it agrees with, or starts a new one. The first frame keeps the
+	// vertex, every further one becomes a copy of it. Past TANGENT_MAX_SPLITS frames corners join the closest one.
+	for (S64 vertex = 0; vertex < vertices_count; vertex += 1) {
+		Vec3F32 frame_sums[TANGENT_MAX_SPLITS];
+		F32 frame_signs[TANGENT_MAX_SPLITS];
+		U32 frame_vertices[TANGENT_MAX_SPLITS];
+		S32 frames_count = 0;
+		for (U32 j = buffers->corner_offsets[vertex]; j < buffers->corner_offsets[vertex + 1]; j += 1) {
+			U32 corner = buffers->corners[j];
+			Vec4F32 corner_tangent = buffers->corner_tangents[corner];
+			Vec3F32 tangent = {corner_tangent.x, corner_tangent.y, corner_tangent.z};
+			F32 sign = corner_tangent.w;
+
+			S32 frame = -1;
+			for (S32 k = 0; k < frames_count && frame < 0; k += 1) {
+				if (frame_signs[k] == sign && dot_3f32(frame_sums[k], tangent) >= 0.0f) {
+					frame = k;
+				}
+			}
+			if (frame < 0 && frames_count < TANGENT_MAX_SPLITS) {
+				frame = frames_count++;
+				frame_sums[frame] = {};
+				frame_signs[frame] = sign;
+				frame_vertices[frame] = (U32)vertex;
+				if (frame > 0) {
+					frame_vertices[frame] = (U32)object->vertices_count;
+					object_build->unique_corners[object->vertices_count++] = object_build->unique_corners[vertex];
+				}
+			} else if (frame < 0) {
+				frame = 0;
+				F32 best_dot = -F32_MAX;
+				for (S32 k = 0; k < frames_count; k += 1) {
+					F32 dot = dot_3f32(frame_sums[k], tangent);
+					if (frame_signs[k] == sign && dot > best_dot) {
+						frame = k;
+						best_dot = dot;
+					}
+				}
+			}
+			frame_sums[frame] = frame_sums[frame] + tangent;
+			indices[corner] = frame_vertices[frame];
+		}
+
+		Vec3F32 normal = state->normals[object_build->unique_corners[vertex].vn];
+		for (S32 k = 0; k < frames_count; k += 1) {
+			F32 length = len_3f32(frame_sums[k]);
+			Vec3F32 tangent = (length > 0.0f) ? frame_sums[k] * (1.0f / length) : get_fallback_tangent(normal);
+			object_build->tangents[frame_vertices[k]] = {tangent.x, tangent.y, tangent.z, frame_signs[k]};
+		}
+	}
+}
+
+// Gives every object its unique vertices plus an index buffer. With a pool the objects are built in parallel.
+void build_objects(Scene_Build *build, Thread_Pool *pool) {
+	ProfileTraceZone("build_objects");
+	if (build->generate_normals) {
+		generate_normals(build, pool);
+	}
+
+	// Allocation isn't thread safe, so everything is sized here: the index buffers exactly, and the deduplication
+	// tables and unique corners from the number of corners.
+	for (S64 i = 0; i < build->objects_count; i += 1) {
+		Object_Build *object_build = &build->objects[i];
+		S64 table_size = next_power_of(2, object_build->corners_count * 2);
+		object_build->unique_corners = (Face_Corner*)arena_alloc(build->temp, sizeof(Face_Corner) * object_build->corners_count + sizeof(U32) * table_size);
+		if (build->compact_indices) {
+			// The width is only known after deduplication.
+			object_build->indices = (OBJ_Index*)arena_alloc(build->temp, sizeof(OBJ_Index) * object_build->corners_count);
+			object_build->object->indices = object_build->indices;
+		} else {
+			object_build->object->indices = (OBJ_Index*)arena_alloc(build->arena, sizeof(OBJ_Index) * object_build->corners_count);
+		}
+		if (build->split_indices && object_build->corners_count > OBJ_INDEX16_MAX_VERTICES) {
+			// Every submesh but the last holds more than OBJ_INDEX16_MAX_VERTICES - 3 vertices.
+			S64 max_submeshes = object_build->corners_count / (OBJ_INDEX16_MAX_VERTICES - 2) + 1;
+			object_build->split_corners = (Face_Corner*)arena_alloc(build->temp, sizeof(Face_Corner) * object_build->corners_count);
+			if (build->tangents) {
+				object_build->split_tangents = (Vec4F32*)arena_alloc(build->temp, sizeof(Vec4F32) * object_build->corners_count);
+			}
+			object_build->submeshes = (OBJ_Submesh*)arena_alloc(build->temp, sizeof(OBJ_Submesh) * max_submeshes);
+		}
+		if (build->tangents) {
+			allocate_tangent_buffers(build->temp, object_build);
+		}
+	}
+	thread_pool_run(pool, build->objects_count, build->layout->deduplicate_object, build);
+	if (build->tangents) {
+		thread_pool_run(pool, build->objects_count, generate_object_tangents, build);
+	}
+
+	if (build->optimize_vertex_cache) {
+		for (S64 i = 0; i < build->objects_count; i += 1) {
+			allocate_vertex_cache_buffers(build->temp, &build->objects[i]);
+		}
+	}
+	if (build->optimize_vertex_cache || build->split_indices) {
+		thread_pool_run(pool, build->objects_count, prepare_object_indices, build);
+	}
+	if (build->meshlets) {
+		for (S64 i = 0; i < build->objects_count; i += 1) {
+			allocate_meshlet_buffers(build->temp, &build->objects[i]);
+		}
+		thread_pool_run(pool, build->objects_count, build_object_meshlets, build);
+	}
+
+	for (S64 i = 0; i < build->objects_count; i += 1) {
+		Object_Build *object_build = &build->objects[i];
+		OBJ_Object *object = object_build->object;
+		if (build->compact_indices) {
+			object->index_size = (object->vertices_count <= OBJ_INDEX16_MAX_VERTICES || object_build->submeshes_count) ? sizeof(U16) : sizeof(OBJ_Index);
+			object->index_data = arena_alloc(build->arena, object->index_size * object->indices_count);
+		}
+		if (object_build->submeshes_count) {
+			object->submeshes_count = object_build->submeshes_count;
+			object->submeshes = (OBJ_Submesh*)arena_alloc(build->arena, sizeof(OBJ_Submesh) * object->submeshes_count);
+			MemoryCopy(object->submeshes, object_build->submeshes, sizeof(OBJ_Submesh) * object->submeshes_count);
+		}
+		if (build->meshlets) {
+			object->meshlets_count = object_build->meshlets_count;
+			object->meshlets = (OBJ_Meshlet*)arena_alloc(build->arena, sizeof(OBJ_Meshlet) * object->meshlets_count);
+			MemoryCopy(object->meshlets, object_build->meshlets, sizeof(OBJ_Meshlet) * object->meshlets_count);
+			object->meshlet_vertices = (U32*)arena_alloc(build->arena, sizeof(U32) * object_build->meshlet_vertices_count);
+			MemoryCopy(object->meshlet_vertices, object_build->meshlet_vertices, sizeof(U32) * object_build->meshlet_vertices_count);
+			object->meshlet_triangles = (U8*)arena_alloc(build->arena, object_build->meshlet_triangles_count * 3);
+			MemoryCopy(object->meshlet_triangles, object_build->meshlet_triangles, object_build->meshlet_triangles_count * 3);
+		}
+		if (build->tangents) {
+			object->tangents = (Vec4F32*)arena_alloc(build->arena, sizeof(Vec4F32) * object->vertices_count);
+			MemoryCopy(object->tangents, object_build->tangents, sizeof(Vec4F32) * object->vertices_count);
+		}
+		object->vertex_layout = build->layout->layout;
+		if (build->streams) {
+			allocate_vertex_streams(build->arena, object, build->layout->attributes);
+		} else {
+			object->vertex_data = arena_alloc(build->arena, build->layout->vertex_size * object->vertices_count);
+		}
+	}
+	thread_pool_run(pool, build->objects_count, build->streams ? build->layout->gather_object_streams : build->layout->gather_object_vertices, build);
+	if (build->compact_indices) {
+		thread_pool_run(pool, build->objects_count, store_object_indices, build);
+	}
+}
+
+// Builds the objects of the scene from the parsed chunks.
+OBJ_Scene *build_scene(Arena *arena, Arena *temp, Parse_State *state, Parse_Chunk *chunks, S64 chunks_count,
+                       Vertex_Layout_Info *layout, U32 flags, Thread_Pool *pool) {
+	ProfileTraceZone("build_scene");
+	Scene_Build build = {};
+	build.arena = arena;
+	build.temp = temp;
+	build.scene = make_scene(arena);
+	build.state = state;
+	build.layout = layout;
+	build.streams = flags & PARSE_FLAG_SOA;
+	build.split_indices = flags & PARSE_FLAG_SPLIT_INDICES;
+	build.compact_indices = build.split_indices || (flags & PARSE_FLAG_16BIT_INDICES);
+	build.optimize_vertex_cache = flags & PARSE_FLAG_OPTIMIZE_VERTEX_CACHE;
+	build.meshlets = flags & PARSE_FLAG_MESHLETS;
+	build.generate_normals = generates_normals(layout, flags);
+	build.angle_weighted_normals = flags & PARSE_FLAG_ANGLE_WEIGHTED_NORMALS;
+	build.tangents = (flags & PARSE_FLAG_TANGENTS) && (layout->attributes & OBJ_VERTEX_NORMAL) && (layout->attributes & OBJ_VERTEX_TEX_COORD);
+
+	if (build.generate_normals) {
+		resolve_smoothing_groups(chunks, chunks_count);
+	}
+	stitch_segments(&build, chunks, chunks_count);
+	build_objects(&build, pool);
+	update_scene_bounds(build.scene);
+
+	return build.scene;
+}
+
+// Builds a single object in the default layout outside of any scene from a run of corners.
+OBJ_Object *build_object(Arena *arena, Arena *temp, Parse_State *state, String8 name, Face_Corner *corners, S64 corners_count) {
+	Chunk_Segment segment = {};
+	segment.corners = corners;
+	segment.corners_count = corners_count;
+
+	Object_Build object_build = {};
+	object_build.object = make_object(arena);
+	object_build.object->name = name;
+	object_build.segments_first = &segment;
+	object_build.segments_last = &segment;
+	object_build.corners_count = corners_count;
+
+	Vertex_Layout_Info layout = get_vertex_layout_info<OBJ_Vertex>();
+
+	Scene_Build build = {};
+	build.arena = arena;
+	build.temp = temp;
+	build.objects = &object_build;
+	build.objects_count = 1;
+	build.state = state;
+	build.layout = &layout;
+	build_objects(&build, NULL);
+
+	return object_build.object;
+}
+
+Parse_Result parse_serial(Arena *arena, char *file_name, File file, Vertex_Layout_Info *layout, U32 flags) {
+	ProfileTraceZone("parse_serial");
+	Arena temp;
+	arena_init(&temp, Megabytes(1), ARENA_FLAG_NONE, get_parse_reserve_size(file.len));
+
+	Parse_Storage storage;
+	init_parse_storage(&storage, file.len);
+
+	Parse_Chunk chunk = {};
+	chunk.text = {(char*)file.data, file.len};
+	chunk.last = true;
+
+	Parse_State state = {};
+	state.tokenizer = make_tokenizer(file_name, (char *)file.data, file.len);
+	state.chunk = &chunk;
+	state.storage = &storage;
+	state.skipped_statements = get_skipped_statements(layout, flags);
+	state.smoothing_group = SMOOTHING_GROUP_NONE;
+	make_attribute_lists(&storage.positions, &storage.tex_coords, &storage.normals, &state, 4095, 4095, 4095);
+
+	bool success = parse_statements(&state, false);
+	OBJ_Scene *scene = build_scene(arena, &temp, &state, &chunk, 1, layout, flags, NULL);
+
+	release_parse_storage(&storage);
+	arena_release(&temp);
+	return {scene, chunk.end_line, success && file.success, file};
+}
+
+// Returns where the first chunk starting at or after at begins: at a keyword, after a line break. Any keyword starts a
+// new statement, and no token or comment spans a line break, so the chunk can be parsed on its own from there.
+char *find_chunk_start(char *at, char *end) {
+	while (at < end) {
+		char *line_feed = (char*)memchr(at, '\n', end - at);
+		if (!line_feed) {
+			break;
+		}
+		Tokenizer t = make_tokenizer("", line_feed + 1, end - (line_feed + 1));
+		skip_whitespace_and_comments(&t);
+		if (keyword_kind(scan_word(&t)) != KIND_NONE) {
+			return t.at;
+		}
+		at = t.at;
+	}
+	return end;
+}
+
+// Counts lines and statements without converting anything. The number of face corners is an upper bound: every word
+// following an 'f' up to the next keyword.
+void count_chunk(void *data, S64 chunk_index) {
+	ProfileTraceZone("count_chunk");
+	Parse_Chunk *chunk = &((Parse_Chunk*)data)[chunk_index];
+	Tokenizer t = make_tokenizer("", chunk->text.start, chunk->text.len);
+	t.line_number = 0;
+
+	bool in_face = false;
+	for (;;) {
+		skip_whitespace_and_comments(&t);
+		String8 word = scan_word(&t);
+		if (word.len == 0) {
+			break;
+		}
+		t.at += word.len;
+
+		int kind = keyword_kind(word);
+		chunk->positions_count += kind == KIND_KEYWORD_V;
+		chunk->tex_coords_count += kind == KIND_KEYWORD_VT;
+		chunk->normals_count += kind == KIND_KEYWORD_VN;
+		chunk->objects_count += kind == KIND_KEYWORD_O;
+		if (kind != KIND_NONE) {
+			in_face = kind == KIND_KEYWORD_F;
+		} else {
+			chunk->corners_capacity += in_face;
+		}
+	}
+	chunk->lines = t.line_number;
+}
+
+typedef struct Chunk_Job Chunk_Job;
+struct Chunk_Job {
+	Parse_Chunk *chunks;
+	Parse_State *state; // Holds the global attribute lists.
+	char *file_name;
+};
+
+void parse_chunk(void *data, S64 chunk_index) {
+	ProfileTraceZone("parse_chunk");
+	Chunk_Job *job = (Chunk_Job*)data;
+	Parse_Chunk *chunk = &job->chunks[chunk_index];
+
+	Parse_State state = {};
+	state.chunk = chunk;
+	state.tokenizer = make_tokenizer(job->file_name, chunk->text.start, chunk->text.len);
+	state.tokenizer.line_number = chunk->first_line;
+	state.tokenizer.silent = true;
+	state.skipped_statements = job->state->skipped_statements;
+	state.smoothing_group = (chunk_index == 0) ? SMOOTHING_GROUP_NONE : SMOOTHING_GROUP_INHERITED;
+	state.positions = job->state->positions;
+	state.tex_coords = job->state->tex_coords;
+	state.normals = job->state->normals;
+	state.position_index = chunk->first_position;
+	state.tex_coord_index = chunk->first_tex_coord;
+	state.normal_index = chunk->first_normal;
+	state.positions_capacity = chunk->first_position + chunk->positions_count;
+	state.tex_coords_capacity = chunk->first_tex_coord + chunk->tex_coords_count;
+	state.normals_capacity = chunk->first_normal + chunk->normals_count;
+
+	parse_statements(&state, !chunk->last);
+}
+
+// Produces the same scene as parse_serial(), independent of the thread count. If any chunk fails the file is parsed
+// again serially, which reports the error exactly as a serial parse would.
+Parse_Result parse_chunked(Arena *arena, char *file_name, File file, S32 thread_count, Vertex_Layout_Info *layout, U32 flags) {
+	ProfileTraceZone("parse_chunked");
+	size_t arena_used = arena->used;
+
+	// The lists each get an arena of their own and the scratch of building the scene another, all sized from the file.
+	Arena temp;
+	arena_init(&temp, Megabytes(1), ARENA_FLAG_NONE, get_parse_reserve_size(file.len));
+	Parse_Storage storage;
+	init_parse_storage(&storage, file.len);
+
+	char *text = (char*)file.data;
+	char *end = text + file.len;
+
+	Parse_Chunk *chunks = (Parse_Chunk*)arena_alloc(&temp, sizeof(Parse_Chunk) * thread_count);
+	MemoryZero(chunks, sizeof(Parse_Chunk) * thread_count);
+	S64 chunks_count = 0;
+	char *chunk_start = text;
+	for (S32 i = 1; i <= thread_count; i += 1) {
+		char *chunk_end = (i == thread_count) ? end : find_chunk_start(Max(chunk_start, text + file.len / thread_count * i), end);
+		if (chunk_end > chunk_start || i == thread_count) {
+			chunks[chunks_count++].text = {chunk_start, (size_t)(chunk_end - chunk_start)};
+		}
+		chunk_start = chunk_end;
+	}
+	chunks[chunks_count - 1].last = true;
+
+	Thread_Pool *pool = get_thread_pool();
+	thread_pool_run(pool, chunks_count, count_chunk, chunks);
+
+	// Prefix sums give each chunk its starting line and indices. The attribute lists are global, sized exactly, and each
+	// chunk writes its own part of them. Like everything else besides the scene they are temporary.
+	U32 skipped_statements = get_skipped_statements(layout, flags);
+	S64 lines = 1, positions_count = 0, tex_coords_count = 0, normals_count = 0;
+	for (S64 i = 0; i < chunks_count; i += 1) {
+		Parse_Chunk *chunk = &chunks[i];
+		chunk->first_line = lines;
+		chunk->first_position = positions_count + 1;
+		chunk->first_tex_coord = tex_coords_count + 1;
+		chunk->first_normal = normals_count + 1;
+		lines += chunk->lines;
+		positions_count += chunk->positions_count;
+		tex_coords_count += chunk->tex_coords_count;
+		normals_count += chunk->normals_count;
+
+		chunk->corners = (Face_Corner*)arena_alloc(&storage.corners, sizeof(Face_Corner) * chunk->corners_capacity);
+		chunk->segments_capacity = chunk->objects_count + 1;
+		chunk->segments = (Chunk_Segment*)arena_alloc(&storage.segments, sizeof(Chunk_Segment) * chunk->segments_capacity);
+		if (!(skipped_statements & (1u << KIND_KEYWORD_S))) {
+			chunk->smoothing_groups_capacity = (chunk->corners_capacity + 2) / 3;
+			chunk->smoothing_groups = (U32*)arena_alloc(&storage.smoothing_groups, sizeof(U32) * chunk->smoothing_groups_capacity);
+		}
+	}
+
+	Parse_State state = {};
+	state.skipped_statements = skipped_statements;
+	make_attribute_lists(&storage.positions, &storage.tex_coords, &storage.normals, &state, positions_count, tex_coords_count, normals_count);
+
+	Chunk_Job job = {chunks, &state, file_name};
+	thread_pool_run(pool, chunks_count, parse_chunk, &job);
+
+	bool success = true;
+	for (S64 i = 0; i < chunks_count && success; i += 1) {
+		success = chunks[i].success;
+	}
+
+	Parse_Result result;
+	if (success) {
+		OBJ_Scene *scene = build_scene(arena, &temp, &state, chunks, chunks_count, layout, flags, pool);
+		result = {scene, chunks[chunks_count - 1].end_line, file.success, file};
+	} else {
+		arena->used = arena_used;
+		result = parse_serial(arena, file_name, file, layout, flags);
+	}
+
+	release_parse_storage(&storage);
+	arena_release(&temp);
+	return result;
+}
+
+//
+// Scene cache
+//
+// A parsed scene can be stored next to its obj file and loaded again without parsing. The cache is position
+// independent: everything refers to other parts of the file by offset from its start. Loading only validates the
+// header and the offsets and builds the object list around the vertex and index arrays of the cache, which are used in
+// place.
+//
+// A cache belongs to one version of one file. It records the path, size, modification time and a hash of the contents
+// of the obj file and is ignored if any of them changed.
+#define SCENE_CACHE_MAGIC "OBJSCENE"
+#define SCENE_CACHE_VERSION 4
+#define SCENE_CACHE_ALIGNMENT 64
+
+typedef struct Scene_Cache_Key Scene_Cache_Key;
+struct Scene_Cache_Key {
+	U64 source_size;
+	U64 source_modified_time;
+	U64 source_hash;
+};
+
+typedef struct Scene_Cache_Header Scene_Cache_Header;
+struct Scene_Cache_Header {
+	char magic[8];
+	U32 version;
+	U32 header_size;
+	U32 vertex_layout;
+	U32 vertex_size;
+	U32 index_size;
+
+	Scene_Cache_Key key;
+	U64 path_offset; // Null terminated.
+	U64 path_len;
+
+	U64 cache_size; // Detects truncated files.
+	S64 lines_parsed;
+	U64 objects_offset;
+	U64 objects_count;
+};
+
+typedef struct Scene_Cache_Object Scene_Cache_Object;
+struct Scene_Cache_Object {
+	U64 name_offset; // Null terminated.
+	U64 name_len;
+	U64 vertices_offset;
+	U64 vertices_count;
+	U64 indices_offset;
+	U64 indices_count;
+	OBJ_Quantization quantization;
+	OBJ_Bounds bounds;
+};
+
+// Each vertex layout has a cache of its own.
+char *scene_cache_extension[OBJ_VERTEX_LAYOUT_COUNT] = {
+	".scene",
+	".p3.scene",
+	".p3n3.scene",
+	".p3n3t2.scene",
+	".q16.scene",
+};
+
+// Returns the path of the cache of an obj file, allocated in the arena.
+char *get_scene_cache_path(Arena *arena, char *file_name, U32 layout) {
+	size_t len = strlen(file_name);
+	size_t extension_len = strlen(scene_cache_extension[layout]);
+	char *path = (char*)arena_alloc(arena, len + extension_len + 1);
+	MemoryCopy(path, file_name, len);
+	MemoryCopy(path + len, scene_cache_extension[layout], extension_len + 1);
+	return path;
+}
+
+bool make_scene_cache_key(char *file_name, Scene_Cache_Key *key) {
+	File source = map_file(file_name);
+	if (!source.success) {
+		return false;
+	}
+	key->source_size = source.len;
+	key->source_modified_time = get_file_modified_time(file_name);
+	key->source_hash = hash_bytes(source.data, source.len);
+	unmap_file(&source);
+	return true;
+}
+
+// Reserves space for count elements in the cache being laid out.
+U64 scene_cache_reserve(U64 *cache_size, U64 size) {
+	U64 offset = get_aligned_size(*cache_size, SCENE_CACHE_ALIGNMENT);
+	*cache_size = offset + size;
+	return offset;
+}
+
+bool save_scene_cache(char *file_name, Scene_Cache_Key key, Vertex_Layout_Info *layout, Parse_Result *result) {
+	ProfileTraceZone("save_scene_cache");
+	OBJ_Scene *scene = result->scene;
+	U64 objects_count = 0;
+	for (OBJ_Object *object = scene->objects_first; object; object = object->next) {
+		objects_count += 1;
+	}
+
+	// Lay the cache out, then fill it.
+	U64 cache_size = sizeof(Scene_Cache_Header);
+	size_t path_len = strlen(file_name);
+	U64 path_offset = scene_cache_reserve(&cache_size, path_len + 1);
+	U64 objects_offset = scene_cache_reserve(&cache_size, sizeof(Scene_Cache_Object) * objects_count);
+	for (OBJ_Object *object = scene->objects_first; object; object = object->next) {
+		scene_cache_reserve(&cache_size, object->name.len + 1);
+		scene_cache_reserve(&cache_size, layout->vertex_size * object->vertices_count);
+		scene_cache_reserve(&cache_size, sizeof(OBJ_Index) * object->indices_count);
+	}
+
+	Arena temp;
+	arena_init(&temp);
+	U8 *cache = (U8*)arena_alloc(&temp, cache_size);
+	MemoryZero(cache, cache_size);
+
+	Scene_Cache_Header *header = (Scene_Cache_Header*)cache;
+	MemoryCopy(header->magic, SCENE_CACHE_MAGIC, sizeof(header->magic));
+	header->version = SCENE_CACHE_VERSION;
+	header->header_size = sizeof(Scene_Cache_Header);
+	header->vertex_layout = layout->layout;
+	header->vertex_size = layout->vertex_size;
+	header->index_size = sizeof(OBJ_Index);
+	header->key = key;
+	header->path_offset = path_offset;
+	header->path_len = path_len;
+	header->cache_size = cache_size;
+	header->lines_parsed = result->lines_parsed;
+	header->objects_offset = objects_offset;
+	header->objects_count = objects_count;
+	MemoryCopy(cache + path_offset, file_name, path_len);
+
+	U64 at = objects_offset + sizeof(Scene_Cache_Object) * objects_count;
+	Scene_Cache_Object *cache_object = (Scene_Cache_Object*)(cache + objects_offset);
+	for (OBJ_Object *object = scene->objects_first; object; object = object->next, cache_object += 1) {
+		cache_object->name_len = object->name.len;
+		cache_object->name_offset = scene_cache_reserve(&at, object->name.len + 1);
+		MemoryCopy(cache + cache_object->name_offset, object->name.start, object->name.len);
+
+		cache_object->vertices_count = object->vertices_count;
+		cache_object->vertices_offset = scene_cache_reserve(&at, layout->vertex_size * object->vertices_count);
+		MemoryCopy(cache + cache_object->vertices_offset, object->vertex_data, layout->vertex_size * object->vertices_count);
+
+		cache_object->quantization = object->quantization;
+		cache_object->bounds = object->bounds;
+		cache_object->indices_count = object->indices_count;
+		cache_object->indices_offset = scene_cache_reserve(&at, sizeof(OBJ_Index) * object->indices_count);
+		MemoryCopy(cache + cache_object->indices_offset, object->indices, sizeof(OBJ_Index) * object->indices_count);
+	}
+	Assert(at == cache_size);
+
+	Arena *scratch = begin_scratch();
+	bool success = write_file(get_scene_cache_path(scratch, file_name, layout->layout), cache, cache_size);
+	end_scratch(scratch);
+	arena_release(&temp);
+	return success;
+}
+
+bool scene_cache_range_valid(Scene_Cache_Header *header, U64 offset, U64 count, U64 element_size) {
+	return offset <= header->cache_size && count <= (header->cache_size - offset) / element_size;
+}
+
+// The indices come straight from the file, so they are checked before anything reads vertices through them.
+bool scene_cache_indices_valid(OBJ_Index *indices, U64 indices_count, U64 vertices_count) {
+	OBJ_Index max_index = 0;
+	for (U64 i = 0; i < indices_count; i += 1) {
+		max_index = Max(max_index, indices[i]);
+	}
+	return indices_count == 0 || max_index < vertices_count;
+}
+
+// Loads the scene from the cache of the obj file if the cache matches the key. The cache is read or mapped like the obj
+// file itself would be.
+bool load_scene_cache(Arena *arena, char *file_name, Scene_Cache_Key key, Vertex_Layout_Info *layout, U32 flags, Parse_Result *result) {
+	ProfileTraceZone("load_scene_cache");
+	Arena *scratch = begin_scratch();
+	char *cache_path = get_scene_cache_path(scratch, file_name, layout->layout);
+	if (!get_file_modified_time(cache_path)) {
+		end_scratch(scratch);
+		return false;
+	}
+	size_t arena_used = arena->used;
+	File cache = (flags & PARSE_FLAG_MAP_FILE) ? map_file(cache_path) : read_file(arena, cache_path);
+	end_scratch(scratch);
+
+	Scene_Cache_Header *header = (Scene_Cache_Header*)cache.data;
+	size_t path_len = strlen(file_name);
+	bool valid = cache.success && cache.len >= sizeof(Scene_Cache_Header) &&
+	             0 == memcmp(header->magic, SCENE_CACHE_MAGIC, sizeof(header->magic)) &&
+	             header->version == SCENE_CACHE_VERSION &&
+	             header->header_size == sizeof(Scene_Cache_Header) &&
+	             header->vertex_layout == layout->layout &&
+	             header->vertex_size == layout->vertex_size &&
+	             header->index_size == sizeof(OBJ_Index) &&
+	             header->cache_size == cache.len &&
+	             0 == memcmp(&header->key, &key, sizeof(key)) &&
+	             header->path_len == path_len &&
+	             scene_cache_range_valid(header, header->path_offset, path_len, 1) &&
+	             0 == memcmp(cache.data + header->path_offset, file_name, path_len) &&
+	             scene_cache_range_valid(header, header->objects_offset, header->objects_count, sizeof(Scene_Cache_Object));
+
+	Scene_Cache_Object *cache_objects = valid ? (Scene_Cache_Object*)(cache.data + header->objects_offset) : NULL;
+	for (U64 i = 0; valid && i < header->objects_count; i += 1) {
+		Scene_Cache_Object *cache_object = &cache_objects[i];
+		valid = scene_cache_range_valid(header, cache_object->name_offset, cache_object->name_len, 1) &&
+		        scene_cache_range_valid(header, cache_object->vertices_offset, cache_object->vertices_count, layout->vertex_size) &&
+		        scene_cache_range_valid(header, cache_object->indices_offset, cache_object->indices_count, sizeof(OBJ_Index)) &&
+		        cache_object->vertices_offset % SCENE_CACHE_ALIGNMENT == 0 && cache_object->indices_offset % SCENE_CACHE_ALIGNMENT == 0 &&
+		        scene_cache_indices_valid((OBJ_Index*)(cache.data + cache_object->indices_offset), cache_object->indices_count,
+		                                  cache_object->vertices_count);
+	}
+	if (!valid) {
+		unmap_file(&cache);
+		arena->used = arena_used;
+		return false;
+	}
+
+	OBJ_Scene *scene = make_scene(arena);
+	make_name_table(arena, &scene->names, header->objects_count);
+	for (U64 i = 0; i < header->objects_count; i += 1) {
+		Scene_Cache_Object *cache_object = &cache_objects[i];
+		String8 name = {(char*)cache.data + cache_object->name_offset, cache_object->name_len};
+		U64 hash = hash_ascii(name.start, name.len);
+
+		OBJ_Object *object = make_object(arena);
+		OBJ_Name_Entry *entry = lookup_name(&scene->names, name, hash);
+		insert_name(arena, &scene->names, entry, name, hash, object);
+		object->name = entry->name;
+		object->vertex_layout = layout->layout;
+		object->vertex_data = cache.data + cache_object->vertices_offset;
+		object->vertices_count = cache_object->vertices_count;
+		object->quantization = cache_object->quantization;
+		object->bounds = cache_object->bounds;
+		object->indices = (OBJ_Index*)(cache.data + cache_object->indices_offset);
+		object->indices_count = cache_object->indices_count;
+		append_object(scene, object);
+	}
+	update_scene_bounds(scene);
+
+	*result = {scene, header->lines_parsed, true, cache};
+	return true;
+}
+
+// Vertex is one of the OBJ_Vertex layouts. The vertices of the objects are then read with get_vertices<Vertex>().
+template <typename Vertex = OBJ_Vertex>
+Parse_Result parse(Arena *arena, char *file_name, U32 flags = PARSE_FLAG_NONE, S32 thread_count = 0) {
+	ProfileTraceZone("parse");
+	Vertex_Layout_Info layout = get_vertex_layout_info<Vertex>();
+
+	// An arena that hasn't reserved yet is sized for the file. One that has must have room left for the text, or the
+	// cache, and the scene, else the read fails or the build runs out of memory.
+	if (!arena->base) {
+		size_t reserve_size = get_parse_reserve_size(get_file_size(file_name));
+		arena->reserve_size = Max(arena->reserve_size, reserve_size);
+	}
+
+	Scene_Cache_Key cache_key = {};
+	U32 uncached_flags = PARSE_FLAG_SOA | PARSE_FLAG_16BIT_INDICES | PARSE_FLAG_SPLIT_INDICES | PARSE_FLAG_OPTIMIZE_VERTEX_CACHE |
+	                     PARSE_FLAG_MESHLETS | PARSE_FLAG_GENERATE_NORMALS | PARSE_FLAG_ANGLE_WEIGHTED_NORMALS | PARSE_FLAG_TANGENTS;
+	bool use_cache = (flags & PARSE_FLAG_CACHE) && !(flags & uncached_flags) && make_scene_cache_key(file_name, &cache_key);
+	if (use_cache) {
+		Parse_Result cached;
+		if (load_scene_cache(arena, file_name, cache_key, &layout, flags, &cached)) {
+			return cached;
+		}
+	}
+
+	File file = (flags & PARSE_FLAG_MAP_FILE) ? map_file(file_name) : read_file(arena, file_name);
+	if (!file.success) {
+		printf("Failed to read file %s.\n", file_name);
+	}
+
+	if (thread_count <= 0) {
+		thread_count = get_processor_count();
+	}
+
+	Parse_Result result;
+	if ((flags & PARSE_FLAG_MULTITHREADED) && thread_count > 1 && file.len >= PARSE_CHUNK_MIN_SIZE) {
+		result = parse_chunked(arena, file_name, file, thread_count, &layout, flags);
+	} else {
+		result = parse_serial(arena, file_name, file, &layout, flags);
+	}
+
+	// Only complete scenes are cached. The key must still describe the text that was parsed.
+	if (use_cache && result.success && file.len == cache_key.source_size && hash_bytes(file.data, file.len) == cache_key.source_hash) {
+		save_scene_cache(file_name, cache_key, &layout, &result);
+	}
+	return result;
+}
+
+// Parses the file without building a scene: everything goes to the callbacks. Nothing is allocated; the file is mapped.
+// Returns whether the file is valid. Errors are reported like parse() reports them.
+bool parse_with_callbacks(char *file_name, Parse_Callbacks *callbacks, S64 *lines_parsed = NULL) {
+	File file = map_file(file_name);
+	if (!file.success) {
+		printf("Failed to read file %s.\n", file_name);
+	}
+
+	Parse_State state = {};
+	state.tokenizer = make_tokenizer(file_name, (char*)file.data, file.len);
+	state.callbacks = callbacks;
+	state.skipped_statements = (!callbacks->on_object      ? (1u << KIND_KEYWORD_O)  : 0) |
+	                           (!callbacks->on_position    ? (1u << KIND_KEYWORD_V)  : 0) |
+	                           (!callbacks->on_tex_coord   ? (1u << KIND_KEYWORD_VT) : 0) |
+	                           (!callbacks->on_normal      ? (1u << KIND_KEYWORD_VN) : 0) |
+	                           (!callbacks->on_face_corner ? (1u << KIND_KEYWORD_F)  : 0) |
+	                           (1u << KIND_KEYWORD_S); // Smoothing groups have no callback.
+	state.position_index = 1;
+	state.tex_coord_index = 1;
+	state.normal_index = 1;
+
+	bool success = parse_statements(&state, false) && file.success;
+	if (lines_parsed) {
+		*lines_parsed = state.tokenizer.line_number;
+	}
+	unmap_file(&file);
+	return success;
+}
+
+void release_parse_result(Parse_Result *result) {
+	unmap_file(&result->file);
+	result->scene = NULL;
+}
+
+//
+// Quantization error
+//
+
+typedef struct OBJ_Quantization_Error OBJ_Quantization_Error;
+struct OBJ_Quantization_Error {
+	F32 position;       // Largest distance between a decoded and the original position.
+	F32 position_bound; // Half a quantization step along the diagonal, which the position error can't exceed.
+	F32 normal_degrees; // Largest angle between a decoded and the original normal.
+	F32 tex_coord;      // Largest difference of a decoded texture coordinate component.
+	S64 vertices_count;
+};
+
+Vec3F32 decode_position(OBJ_Object *object, OBJ_Vertex_Q16 *vertex) {
+	Vec3F32 quantized = {(F32)vertex->v[0], (F32)vertex->v[1], (F32)vertex->v[2]};
+	return object->quantization.position_offset + quantized * object->quantization.position_scale;
+}
+
+// Compares a scene parsed with OBJ_Vertex_Q16 to the same file parsed with OBJ_Vertex or OBJ_Vertex_P3N3T2, which
+// deduplicate the same way. Fails if the scenes don't match up.
+bool get_quantization_error(OBJ_Scene *quantized, OBJ_Scene *reference, OBJ_Quantization_Error *error) {
+	*error = {};
+	OBJ_Object *reference_object = reference->objects_first;
+	for (OBJ_Object *object = quantized->objects_first; object; object = object->next) {
+		if (!reference_object || object->vertex_layout != OBJ_VERTEX_LAYOUT_Q16 || !object->vertex_data ||
+		    !reference_object->vertex_data || object->vertices_count != reference_object->vertices_count ||
+		    (reference_object->vertex_layout != OBJ_VERTEX_LAYOUT_P4N3T3 &&
+		     reference_object->vertex_layout != OBJ_VERTEX_LAYOUT_P3N3T2)) {
+			return false;
+		}
+
+		F32 bound = 0.5f * len_3f32(object->quantization.position_scale);
+		error->position_bound = Max(error->position_bound, bound);
+
+		OBJ_Vertex_Q16 *vertices = get_vertices<OBJ_Vertex_Q16>(object);
+		for (S64 i = 0; i < object->vertices_count; i += 1) {
+			Vec3F32 position, tex_coord, normal;
+			if (reference_object->vertex_layout == OBJ_VERTEX_LAYOUT_P4N3T3) {
+				OBJ_Vertex *vertex = &reference_object->vertices[i];
+				position = {vertex->v.x, vertex->v.y, vertex->v.z};
+				tex_coord = vertex->vt;
+				normal = vertex->vn;
+			} else {
+				OBJ_Vertex_P3N3T2 *vertex = &get_vertices<OBJ_Vertex_P3N3T2>(reference_object)[i];
+				position = vertex->v;
+				tex_coord = {vertex->vt.x, vertex->vt.y, 0.0f};
+				normal = vertex->vn;
+			}
+
+			error->position = Max(error->position, len_3f32(decode_position(object, &vertices[i]) - position));
+
+			F32 u_error = Abs(f16_to_f32(vertices[i].vt[0]) - tex_coord.x);
+			F32 v_error = Abs(f16_to_f32(vertices[i].vt[1]) - tex_coord.y);
+			error->tex_coord = Max(error->tex_coord, Max(u_error, v_error));
+
+			if (len_3f32(normal) > 0.0f) {
+				F32 similarity = dot_3f32(decode_octahedral(vertices[i].vn[0], vertices[i].vn[1]), normalize_3f32(normal));
+				F32 degrees = acosf(Clamp(similarity, -1.0f, 1.0f)) * (180.0f / 3.14159265f);
+				error->normal_degrees = Max(error->normal_degrees, degrees);
+			}
+		}
+		error->vertices_count += object->vertices_count;
+		reference_object = reference_object->next;
+	}
+	return reference_object == NULL;
+}
+
+//
+// Vertex cache statistics
+//
+
+typedef struct OBJ_Vertex_Cache_Stats OBJ_Vertex_Cache_Stats;
+struct OBJ_Vertex_Cache_Stats {
+	S64 triangles_count;
+	S64 vertices_count;
+	S64 transforms_count; // Cache misses.
+	F32 acmr; // Transforms per triangle: 3 at worst, around 0.5 for large regular meshes.
+	F32 atvr; // Transforms per vertex: 1 at best.
+};
+
+// Reads index i of an object whatever its index size, adding the first vertex of its submesh.
+U32 get_object_index(OBJ_Object *object, S64 i, S64 first_vertex) {
+	U32 index = (object->index_size == sizeof(U16)) ? object->indices_u16[i] : object->indices[i];
+	return (U32)(index + first_vertex);
+}
+
+// Simulates a FIFO post-transform cache of cache_size entries, flushed between objects, over every index buffer.
+OBJ_Vertex_Cache_Stats get_vertex_cache_stats(OBJ_Scene *scene, S32 cache_size = 16) {
+	OBJ_Vertex_Cache_Stats stats = {};
+	Arena *scratch = begin_scratch();
+	for (OBJ_Object *object = scene->objects_first; object; object = object->next) {
+		// A vertex is cached if fewer than cache_size transforms happened since its own.
+		S64 *transformed_at = (S64*)arena_alloc(scratch, sizeof(S64) * object->vertices_count);
+		for (S64 i = 0; i < object->vertices_count; i += 1) {
+			transformed_at[i] = -(S64)cache_size - 1;
+		}
+		S64 transforms_count = cache_size + 1; // Keeps everything from the previous object out of the cache.
+
+		OBJ_Submesh whole = {0, object->indices_count, 0, object->vertices_count};
+		OBJ_Submesh *submeshes = object->submeshes ? object->submeshes : &whole;
+		S64 submeshes_count = object->submeshes ? object->submeshes_count : 1;
+		for (S64 s = 0; s < submeshes_count; s += 1) {
+			OBJ_Submesh *submesh = &submeshes[s];
+			for (S64 i = submesh->first_index; i < submesh->first_index + submesh->indices_count; i += 1) {
+				U32 vertex = get_object_index(object, i, submesh->first_vertex);
+				if (transforms_count - transformed_at[vertex] > cache_size) {
+					transformed_at[vertex] = transforms_count;
+					transforms_count += 1;
+					stats.transforms_count += 1;
+				}
+			}
+		}
+		stats.triangles_count += object->indices_count / 3;
+		stats.vertices_count += object->vertices_count;
+		arena_free_all(scratch);
+	}
+	end_scratch(scratch);
+
+	stats.acmr = stats.triangles_count ? (F32)stats.transforms_count / (F32)stats.triangles_count : 0.0f;
+	stats.atvr = stats.vertices_count ? (F32)stats.transforms_count / (F32)stats.vertices_count : 0.0f;
+	return stats;
+}
+
+//
+// Streaming
+//
+// A push parser for data that arrives in pieces, e.g. from a pipe or a socket. Bytes are fed into a window of fixed
+// size. Whenever the window holds complete statements they are parsed and the window is shifted. A statement is
+// complete once the next one has started, so what remains in the window is at most the last, possibly cut off,
+// statement.
+//
+// Every object is handed to a callback as soon as the next 'o' (or the end of the data) finishes it. The object and its
+// arrays are only valid during the callback; their memory is reused for the next object. So apart from the window only
+// the v/vt/vn lists, which faces may refer to at any point, grow with the input.
+//
+// Unlike parse(), an object name that shows up again starts a new object instead of continuing the earlier one.
+typedef void Parse_Object_Proc(OBJ_Object *object, void *user_data);
+
+typedef struct Parse_Stream Parse_Stream;
+struct Parse_Stream {
+	char *name; // Used in error messages.
+	Parse_Object_Proc *on_object;
+	void *user_data;
+
+	char *window;
+	S64 window_size;
+	S64 window_used;
+
+	Parse_Storage storage;
+	Parse_Chunk chunk; // Its corners are those of the current object.
+	Parse_State state;
+
+	// The current object. Its name lives in name_arena because the window moves on.
+	String8 object_name;
+	bool object_named;
+	Arena name_arena;
+	Arena object_arena; // Emptied after every callback.
+	Arena temp;
+
+	S64 lines_parsed;
+	bool success;
+};
+
+#define PARSE_STREAM_DEFAULT_WINDOW_SIZE Megabytes(1)
+
+// The stream must stay at the same address until parse_stream_end().
+void parse_stream_begin(Parse_Stream *stream, char *name, Parse_Object_Proc *on_object, void *user_data,
+                        S64 window_size = PARSE_STREAM_DEFAULT_WINDOW_SIZE) {
+	*stream = {};
+	stream->name = name;
+	stream->on_object = on_object;
+	stream->user_data = user_data;
+	stream->window_size = window_size;
+	stream->window = (char*)allocate_memory(window_size);
+
+	arena_init(&stream->storage.positions);
+	arena_init(&stream->storage.tex_coords);
+	arena_init(&stream->storage.normals);
+	arena_init(&stream->storage.corners);
+	arena_init(&stream->storage.segments);
+	arena_init(&stream->storage.smoothing_groups);
+	arena_init(&stream->name_arena);
+	arena_init(&stream->object_arena);
+	arena_init(&stream->temp);
+
+	stream->state.chunk = &stream->chunk;
+	stream->state.storage = &stream->storage;
+	stream->state.skipped_statements = 1u << KIND_KEYWORD_S; // Streamed objects only get the normals of the file.
+	make_attribute_lists(&stream->storage.positions, &stream->storage.tex_coords, &stream->storage.normals, &stream->state, 4095, 4095, 4095);
+
+	stream->object_name = {"", 0};
+	stream->lines_parsed = 1;
+	stream->success = stream->window != NULL;
+}
+
+// Hands the current object to the callback. Faces before the first 'o' only make an object if there are any.
+void emit_stream_object(Parse_Stream *stream, Face_Corner *corners, S64 corners_count) {
+	if (stream->object_named || corners_count > 0) {
+		OBJ_Object *object = build_object(&stream->object_arena, &stream->temp, &stream->state, stream->object_name, corners, corners_count);
+		stream->on_object(object, stream->user_data);
+		arena_free_all(&stream->object_arena);
+		arena_free_all(&stream->temp);
+	}
+}
+
+// Returns where the last statement in the window starts: the last line whose first word is a complete keyword. 0 if
+// there is none after the start of the window.
+S64 find_last_statement_start(char *text, S64 len) {
+	for (S64 i = len - 1; i > 0; i -= 1) {
+		if (!is_end_of_line(text[i - 1])) {
+			continue;
+		}
+		S64 word_start = i;
+		while (word_start < len && is_spacing(text[word_start])) {
+			word_start += 1;
+		}
+		S64 word_end = word_start;
+		while (word_end < len && !is_whitespace(text[word_end])) {
+			word_end += 1;
+		}
+		// At the end of the window the word may still go on.
+		if (word_end < len && keyword_kind({text + word_start, (size_t)(word_end - word_start)}) != KIND_NONE) {
+			return word_start;
+		}
+	}
+	return 0;
+}
+
+// Parses the first len bytes of the window, which end at a statement boundary unless this is the end of the data.
+void parse_stream_window(Parse_Stream *stream, S64 len, bool end) {
+	Parse_State *state = &stream->state;
+	Parse_Chunk *chunk = &stream->chunk;
+
+	chunk->segments_count = 0;
+	state->tokenizer = make_tokenizer(stream->name, stream->window, len);
+	state->tokenizer.line_number = stream->lines_parsed;
+	stream->success = parse_statements(state, !end);
+	stream->lines_parsed = chunk->end_line;
+
+	// The first segment continues the current object, every further one is started by an 'o'.
+	S64 object_start = 0;
+	for (S64 i = 1; i < chunk->segments_count; i += 1) {
+		Chunk_Segment *segment = &chunk->segments[i];
+		emit_stream_object(stream, chunk->corners + object_start, segment->first_corner - object_start);
+		object_start = segment->first_corner;
+
+		arena_free_all(&stream->name_arena);
+		char *name = (char*)arena_alloc(&stream->name_arena, segment->name.len + 1);
+		MemoryCopy(name, segment->name.start, segment->name.len);
+		name[segment->name.len] = 0;
+		stream->object_name = {name, segment->name.len};
+		stream->object_named = true;
+	}
+	// Only the corners of the current object are kept.
+	chunk->corners_count -= object_start;
+	MemoryMove(chunk->corners, chunk->corners + object_start, sizeof(Face_Corner) * chunk->corners_count);
+
+	if (end && stream->success) {
+		emit_stream_object(stream, chunk->corners, chunk->corners_count);
+	}
+
+	MemoryMove(stream->window, stream->window + len, stream->window_used - len);
+	stream->window_used -= len;
+}
+
+// Returns false once the data turned out to be invalid. Everything fed after that is ignored.
+bool parse_stream_feed(Parse_Stream *stream, void *data, size_t len) {
+	U8 *at = (U8*)data;
+	while (stream->success && len > 0) {
+		size_t copy_len = Min(len, (size_t)(stream->window_size - stream->window_used));
+		MemoryCopy(stream->window + stream->window_used, at, copy_len);
+		stream->window_used += copy_len;
+		at += copy_len;
+		len -= copy_len;
+
+		S64 statement_start = find_last_statement_start(stream->window, stream->window_used);
+		if (statement_start > 0) {
+			parse_stream_window(stream, statement_start, false);
+		} else if (stream->window_used == stream->window_size) {
+			printf("%s (%lld): A statement does not fit into the window of %lld bytes.\n", stream->name, stream->lines_parsed, stream->window_size);
+			stream->success = false;
+		}
+	}
+	return stream->success;
+}
+
+// Parses what is left in the window, hands out the last object and releases the stream's memory. Returns whether all
+// of the data was valid.
+bool parse_stream_end(Parse_Stream *stream) {
+	if (stream->success) {
+		parse_stream_window(stream, stream->window_used, true);
+	}
+
+	if (stream->window) {
+		release_memory(stream->window, stream->window_size);
 	}
+	arena_release(&stream->storage.positions);
+	arena_release(&stream->storage.tex_coords);
+	arena_release(&stream->storage.normals);
+	arena_release(&stream->storage.corners);
+	arena_release(&stream->storage.segments);
+	arena_release(&stream->storage.smoothing_groups);
+	arena_release(&stream->name_arena);
+	arena_release(&stream->object_arena);
+	arena_release(&stream->temp);
+	stream->window = NULL;
 
-	return {scene, tokenizer.line_number, !error && file.success};
+	return stream->success;
 }